@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "gardengeek.h"
+
+/****************** Garden bed allocation functions ******************/
+
+/* One plant's claim on the space in a bed, until its end day */
+struct bed_placement {
+	int		end_day;
+	unsigned int	bed;
+	float		square_feet;
+};
+
+/* Plants that aren't removed at harvest time keep their space all season. */
+#define END_OF_SEASON	INT_MAX
+
+static float get_square_feet_needed(struct plant *new_plant)
+{
+	if (new_plant->square_feet_per_plant <= 0)
+		return new_plant->num_plants_to_harvest;
+	return new_plant->num_plants_to_harvest *
+		new_plant->square_feet_per_plant;
+}
+
+/* A plant takes up garden space from when it goes outside until harvest. */
+int get_outdoor_start_day(struct plant *new_plant)
+{
+	return date_to_day_number(&new_plant->outdoor_planting_date);
+}
+
+int get_outdoor_end_day(struct plant *new_plant)
+{
+	if (!new_plant->harvest_removes_plant)
+		return END_OF_SEASON;
+	return date_to_day_number(&new_plant->harvest_date);
+}
+
+struct garden_bed *load_garden_beds(FILE *fp, unsigned int *num_beds,
+		struct garden_error *error)
+{
+	struct garden_bed *beds = NULL;
+	struct garden_bed *tmp;
+	unsigned int list_size = 0;
+
+	*num_beds = 0;
+	while (skip_comment_lines(fp)) {
+		if (*num_beds == list_size) {
+			list_size = list_size ? list_size*2 : 16;
+			tmp = realloc(beds, sizeof(*beds)*list_size);
+			if (!tmp) {
+				set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+				free_garden_beds(beds, *num_beds);
+				return NULL;
+			}
+			beds = tmp;
+		}
+		if (!copy_word_from_file(fp, &beds[*num_beds].name))
+			break;
+		fscanf(fp, "%f", &beds[*num_beds].square_feet);
+		fgetc(fp);
+		beds[*num_beds].square_feet_free = beds[*num_beds].square_feet;
+		(*num_beds)++;
+	}
+	if (!*num_beds) {
+		set_garden_error(error, GARDEN_EMPTY_FILE, NULL);
+		free(beds);
+		return NULL;
+	}
+	return beds;
+}
+
+void free_garden_beds(struct garden_bed *beds, unsigned int num_beds)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_beds; i++)
+		free(beds[i].name);
+	free(beds);
+}
+
+/* Sort plants by when they go outside, biggest first on the same day */
+static int compare_outdoor_start(const void *this, const void *that)
+{
+	struct plant *a = *(struct plant **) this;
+	struct plant *b = *(struct plant **) that;
+	int a_day = get_outdoor_start_day(a);
+	int b_day = get_outdoor_start_day(b);
+	float a_size, b_size;
+
+	if (a_day != b_day)
+		return a_day < b_day ? -1 : 1;
+	a_size = get_square_feet_needed(a);
+	b_size = get_square_feet_needed(b);
+	if (a_size != b_size)
+		return a_size > b_size ? -1 : 1;
+	return 0;
+}
+
+/* Min-heap of placements, ordered by the day they give their space back */
+static void push_placement(struct bed_placement *heap, unsigned int *heap_size,
+		struct bed_placement *placement)
+{
+	unsigned int i = (*heap_size)++;
+	unsigned int parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (heap[parent].end_day <= placement->end_day)
+			break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = *placement;
+}
+
+static void pop_placement(struct bed_placement *heap, unsigned int *heap_size)
+{
+	struct bed_placement last = heap[--(*heap_size)];
+	unsigned int i = 0;
+	unsigned int child;
+
+	while ((child = 2*i + 1) < *heap_size) {
+		if (child + 1 < *heap_size &&
+				heap[child + 1].end_day < heap[child].end_day)
+			child++;
+		if (last.end_day <= heap[child].end_day)
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+}
+
+/*
+ * Walk through the season in the order plants go outside.  Before placing a
+ * plant, give back the space of every plant harvested by then.  Then put it
+ * in the bed with the least room left that still fits it (best fit), which
+ * leaves the big open spaces for big plants later on.
+ *
+ * plant_beds[i] gets the bed index for plants[i] (after sorting), or -1 if
+ * there wasn't room for it anywhere.
+ */
+int allocate_garden_beds(struct plant **plants, unsigned int num_plants,
+		struct garden_bed *beds, unsigned int num_beds,
+		int *plant_beds)
+{
+	struct bed_placement *heap;
+	struct bed_placement placement;
+	unsigned int heap_size = 0;
+	unsigned int i, j;
+	int start_day, best;
+	float needed;
+
+	heap = malloc(sizeof(*heap)*(num_plants + 1));
+	if (!heap)
+		return 0;
+
+	qsort(plants, num_plants, sizeof(*plants), compare_outdoor_start);
+
+	for (i = 0; i < num_plants; i++) {
+		start_day = get_outdoor_start_day(plants[i]);
+		while (heap_size && heap[0].end_day <= start_day) {
+			beds[heap[0].bed].square_feet_free +=
+				heap[0].square_feet;
+			pop_placement(heap, &heap_size);
+		}
+
+		needed = get_square_feet_needed(plants[i]);
+		best = -1;
+		for (j = 0; j < num_beds; j++) {
+			if (beds[j].square_feet_free < needed)
+				continue;
+			if (best < 0 || beds[j].square_feet_free <
+					beds[best].square_feet_free)
+				best = j;
+		}
+		plant_beds[i] = best;
+		if (best < 0)
+			continue;
+
+		beds[best].square_feet_free -= needed;
+		placement.end_day = get_outdoor_end_day(plants[i]);
+		placement.bed = best;
+		placement.square_feet = needed;
+		push_placement(heap, &heap_size, &placement);
+	}
+	free(heap);
+	return 1;
+}
+
+static void print_bed_placement(FILE *out, struct plant *new_plant)
+{
+	char start[MAX_NAME_LENGTH];
+	char end[MAX_NAME_LENGTH];
+	unsigned int num_plants = new_plant->num_plants_to_harvest;
+
+	strftime(start, MAX_NAME_LENGTH, "%b. %d",
+			&new_plant->outdoor_planting_date);
+	if (new_plant->harvest_removes_plant)
+		strftime(end, MAX_NAME_LENGTH, "%b. %d",
+				&new_plant->harvest_date);
+	else
+		strcpy(end, "end of season");
+	fprintf(out, "   %s - %s: %s -- %u plant%s, %.1f sq. ft.\n",
+			start, end, new_plant->name, num_plants,
+			(num_plants > 1) ? "s" : "",
+			get_square_feet_needed(new_plant));
+}
+
+void print_bed_allocation(FILE *out, struct plant **plants,
+		unsigned int num_plants, struct garden_bed *beds,
+		unsigned int num_beds, int *plant_beds)
+{
+	unsigned int i, j;
+	int unplaced = 0;
+
+	for (j = 0; j < num_beds; j++) {
+		fprintf(out, "\n%s (%.1f sq. ft.):\n", beds[j].name,
+				beds[j].square_feet);
+		for (i = 0; i < num_plants; i++)
+			if (plant_beds[i] == (int) j)
+				print_bed_placement(out, plants[i]);
+	}
+
+	for (i = 0; i < num_plants; i++) {
+		if (plant_beds[i] >= 0)
+			continue;
+		if (!unplaced++)
+			fprintf(out, "\nNo room in any bed for:\n");
+		print_bed_placement(out, plants[i]);
+	}
+}
@@ -0,0 +1,612 @@
+#define _XOPEN_SOURCE 500 /* glibc2 needs this */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <math.h>
+#include "gardengeek.h"
+
+/****************** By plant calendar functions ******************/
+
+/*
+ * num seeds survived = num seeds planted * germination rate
+ * num seeds survived / germination rate = num seeds planted
+ */
+float get_num_seeds_needed(struct plant *new_plant)
+{
+	return ceil(new_plant->num_plants_to_harvest /
+			new_plant->germination_rate);
+}
+
+static void print_date(FILE *out, char *description, struct tm *date)
+{
+	char string[MAX_NAME_LENGTH];
+
+	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+			date);
+	fprintf(out, "%s: %s\n", description, string);
+}
+
+static void print_indoor_plant_dates(FILE *out, struct plant *new_plant)
+{
+	char string[MAX_NAME_LENGTH];
+	float num_seeds;
+
+	num_seeds = get_num_seeds_needed(new_plant);
+	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+			&new_plant->seeding_date);
+	fprintf(out, "Start %i seed%s under grow lamp: %s\n",
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "",
+			string);
+	print_date(out, "Expect sprouting seeds around",
+			&new_plant->sprouting_date);
+	print_date(out, "Last chance for sprouting seeds",
+			&new_plant->last_chance_sprouting_date);
+
+	if (new_plant->num_weeks_until_indoor_separation)
+		print_date(out, "Separate or move to a bigger indoor pot",
+				&new_plant->indoor_separation_date);
+
+	print_date(out, "Start hardening off seedlings",
+			&new_plant->hardening_off_date);
+
+	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+			&new_plant->outdoor_planting_date);
+	num_seeds = new_plant->num_plants_to_harvest;
+	fprintf(out, "Transplant %i plant%s outdoors: %s\n",
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "",
+			string);
+}
+
+static void print_direct_sown_plant_dates(FILE *out, struct plant *new_plant)
+{
+	char string[MAX_NAME_LENGTH];
+	float num_seeds;
+
+	num_seeds = get_num_seeds_needed(new_plant);
+	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+			&new_plant->outdoor_planting_date);
+	fprintf(out, "Direct sow %i seeds outdoors: %s\n",
+			(int) num_seeds, string);
+	print_date(out, "Expect sprouting seeds around",
+			&new_plant->sprouting_date);
+	print_date(out, "Last chance for sprouting seeds",
+			&new_plant->last_chance_sprouting_date);
+	
+	if (new_plant->num_weeks_until_outdoor_separation) {
+		strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+				&new_plant->outdoor_separation_date);
+		num_seeds = new_plant->num_plants_to_harvest;
+		fprintf(out, "Thin to %i plant%s: %s\n",
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "",
+			string);
+	}
+}
+
+void print_action_dates(FILE *out, struct plant *new_plant)
+{
+	int chars_printed;
+	char string[MAX_NAME_LENGTH];
+
+	chars_printed = fprintf(out, "Calendar for %s:\n", new_plant->name);
+	/* Don't count the newline */
+	for(; chars_printed > 1; chars_printed--)
+		fputc('=', out);
+	fprintf(out, "\n");
+
+	if (new_plant->num_weeks_indoors)
+		print_indoor_plant_dates(out, new_plant);
+	else
+		print_direct_sown_plant_dates(out, new_plant);
+
+	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+			&new_plant->harvest_date);
+	if (new_plant->harvest_removes_plant)
+		fprintf(out, "Harvest plants: %s\n", string);
+	else
+		fprintf(out, "Start harvesting: %s\n", string);
+
+}
+
+/****************** By month calendar functions ******************/
+
+/* Is this time less than that time? */
+static int date_is_less_than(struct tm *this,
+		struct tm *that)
+{
+	/* Calendar entries are whole days, so compare day numbers
+	 * instead of turning both into epoch time with mktime().
+	 */
+	return date_to_day_number(this) < date_to_day_number(that);
+}
+
+static int dates_are_equal(struct tm *this, struct tm *that)
+{
+	return date_to_day_number(this) == date_to_day_number(that);
+}
+
+static int sort_in_one_date(struct plant_date *cal_entry,
+		struct date_list **head_ptr)
+{
+	struct date_list **next_ptr = NULL;
+	struct date_list *new_date;
+
+
+	new_date = malloc(sizeof(*new_date));
+	if (!new_date)
+		return 0;
+	new_date->cal_entry = cal_entry;
+
+	/* This is where C++ operator overloading would be great. */
+	for (next_ptr = head_ptr; *next_ptr != NULL;
+			next_ptr = &(*next_ptr)->next) {
+		/* If the new date is less than the next item in the list,
+		 * insert it before that item in the list.
+		 */
+		if (date_is_less_than(cal_entry->date,
+					(*next_ptr)->cal_entry->date)) {
+			new_date->next = *next_ptr;
+			*next_ptr = new_date;
+			return 1;
+		}
+	}
+	new_date->next = NULL;
+	*next_ptr = new_date;
+	return 1;
+}
+
+static struct plant_date *make_calendar_entry(struct tm *date,
+		char *summary, char *description)
+{
+	struct plant_date *cal_entry;
+
+	cal_entry = malloc(sizeof(*cal_entry));
+	if (!cal_entry)
+		return NULL;
+
+	cal_entry->date = date;
+	cal_entry->summary = summary;
+	cal_entry->description = description;
+	return cal_entry;
+}
+
+static int insert_calendar_entry(struct tm *date, char *summary,
+		char *description, struct date_list **head_ptr)
+{
+	struct plant_date *cal_entry;
+
+	cal_entry = make_calendar_entry(date, summary, description);
+	if (!cal_entry)
+		return 0;
+
+	if (!sort_in_one_date(cal_entry, head_ptr))
+		return 0;
+	return 1;
+}
+
+static int add_sprouting_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr)
+{
+	char *summary;
+	char *description;
+
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Expect sprouting seeds around",
+			new_plant->name);
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Sprouting: %s",
+			new_plant->name);
+	if (!insert_calendar_entry(&new_plant->sprouting_date,
+				summary, description, head_ptr))
+		return 0;
+
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Last chance for sprouting seeds",
+			new_plant->name);
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Check sprouts: %s",
+			new_plant->name);
+	if (!insert_calendar_entry(&new_plant->last_chance_sprouting_date,
+				summary, description, head_ptr))
+		return 0;
+	return 1;
+}
+
+/* Organize the dates in the plant into a larger sorted date list */
+int add_indoor_plant_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr, int suppress_sprouting_dates)
+{
+	char *summary;
+	char *description;
+	float num_seeds;
+
+	if (!new_plant->num_weeks_indoors)
+		return 1;
+
+	if (!suppress_sprouting_dates) {
+		if (!add_sprouting_dates_to_list(new_plant, head_ptr))
+			return 0;
+		return 1;
+	}
+
+	/* Starting seeds indoors */
+	num_seeds = get_num_seeds_needed(new_plant);
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Start %i seed%s under grow lamp",
+			new_plant->name,
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "");
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Seed indoors: %s", new_plant->name);
+	if (!insert_calendar_entry(&new_plant->seeding_date,
+				summary, description, head_ptr))
+		return 0;
+
+	/* Separating seeds indoors */
+	if (new_plant->num_weeks_until_indoor_separation) {
+		description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+		if (!description)
+			return 0;
+		snprintf(description, MAX_NAME_LENGTH,
+				"%s -- Separate or move to a bigger indoor pot",
+				new_plant->name);
+		summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+		if (!summary)
+			return 0;
+		snprintf(summary, MAX_NAME_LENGTH,
+				"Separate: %s", new_plant->name);
+		if (!insert_calendar_entry(&new_plant->indoor_separation_date,
+					summary, description, head_ptr))
+			return 0;
+	}
+
+	/* Harden off seedlings */
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Start hardening off seedlings (leave them out during the day and bring them in at night)",
+			new_plant->name);
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Harden off: %s", new_plant->name);
+	if (!insert_calendar_entry(&new_plant->hardening_off_date,
+			       	summary, description, head_ptr))
+		return 0;
+
+	/* Transplant outdoors */
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	num_seeds = new_plant->num_plants_to_harvest;
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Transplant %i plant%s outdoors",
+			new_plant->name,
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "");
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Transplant: %s", new_plant->name);
+	if (!insert_calendar_entry(&new_plant->outdoor_planting_date,
+			       	summary, description, head_ptr))
+		return 0;
+	return 1;
+}
+
+int add_direct_sown_plant_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr, int suppress_sprouting_dates)
+{
+	char *summary;
+	char *description;
+	float num_seeds;
+
+	if (new_plant->num_weeks_indoors)
+		return 1;
+
+	if (!suppress_sprouting_dates) {
+		if (!add_sprouting_dates_to_list(new_plant, head_ptr))
+			return 0;
+		return 1;
+	}
+
+	num_seeds = get_num_seeds_needed(new_plant);
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	snprintf(description, MAX_NAME_LENGTH,
+			"%s -- Direct sow %i seed%s outdoors",
+			new_plant->name,
+			(int) num_seeds,
+			(num_seeds > 1) ? "s" : "");
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Direct sow: %s", new_plant->name);
+	if (!insert_calendar_entry(&new_plant->outdoor_planting_date,
+				summary, description, head_ptr))
+		return 0;
+
+	if (new_plant->num_weeks_until_outdoor_separation) {
+		description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+		num_seeds = new_plant->num_plants_to_harvest;
+		snprintf(description, MAX_NAME_LENGTH,
+				"%s -- Thin to %i plant%s",
+				new_plant->name,
+				(int) num_seeds,
+				(num_seeds > 1) ? "s" : "");
+		summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+		if (!summary)
+			return 0;
+		snprintf(summary, MAX_NAME_LENGTH,
+				"Thin: %s", new_plant->name);
+		if (!insert_calendar_entry(&new_plant->outdoor_separation_date,
+					summary, description, head_ptr))
+			return 0;
+	}
+	return 1;
+}
+
+int add_harvest_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr)
+{
+	char *summary;
+	char *description;
+	unsigned int num_plants;
+
+	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!summary)
+		return 0;
+	snprintf(summary, MAX_NAME_LENGTH,
+			"Harvest: %s", new_plant->name);
+	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
+	if (!description)
+		return 0;
+	num_plants = new_plant->num_plants_to_harvest;
+	if (new_plant->harvest_removes_plant)
+		snprintf(description, MAX_NAME_LENGTH,
+				"%s -- Harvest %u plant%s",
+				new_plant->name,
+				num_plants,
+				(num_plants > 1) ? "s": "");
+	else
+		snprintf(description, MAX_NAME_LENGTH,
+				"%s -- Start harvesting",
+				new_plant->name);
+	if (!insert_calendar_entry(&new_plant->harvest_date,
+			       	summary, description, head_ptr))
+		return 0;
+
+	return 1;
+}
+
+static void print_month_and_year(FILE *out, struct tm *new_date)
+{
+	char string[MAX_NAME_LENGTH];
+	int chars_printed;
+
+	strftime(string, MAX_NAME_LENGTH,
+			"\n%B %Y\n", new_date);
+	chars_printed = fprintf(out, "%s", string);
+	/* Don't count the newline */
+	for(; chars_printed > 1; chars_printed--)
+		fputc('=', out);
+	fprintf(out, "\n");
+}
+
+void make_icalendar(FILE *out, struct date_list *head)
+{
+	struct tm *new_date;
+	struct tm *now;
+	struct tm now_date_fields;
+	struct tm end_date_fields;
+	time_t now_time;
+	struct date_list *item;
+	char start_date[MAX_NAME_LENGTH];
+	char end_date[MAX_NAME_LENGTH];
+	char now_date[MAX_NAME_LENGTH];
+	char uid[4*MAX_NAME_LENGTH];
+	char ptr[MAX_NAME_LENGTH];
+
+	if (!head)
+		return;
+	
+	/* Standard ical stuff */ 
+	fprintf(out, "BEGIN:VCALENDAR\r\n");
+	fprintf(out, "VERSION:2.0\r\n");
+	fprintf(out, "PRODID:-//Sarah Sharp//Garden Calendar Tool v0.1//EN\r\n");
+	/* Following RFC at http://www.ietf.org/rfc/rfc2445.txt */
+
+	for (item = head; item != NULL; item = item->next) {
+		new_date = item->cal_entry->date;
+		fprintf(out, "BEGIN:VEVENT\r\n");
+
+		/* What to use as a unique ID?  Must be "globally unique
+		 * across icalendars.  Seconds since 1970 + hash of
+		 * name?  No requirement that plant names be unique
+		 * across one garden.
+		 */
+		time(&now_time);
+		now = localtime_r(&now_time, &now_date_fields);
+		strftime(uid, MAX_NAME_LENGTH, "%s", now);
+		snprintf(ptr, MAX_NAME_LENGTH, "%p@SSGCT", item);
+		strncat(uid, ptr, 4*MAX_NAME_LENGTH - 1);
+		fprintf(out, "UID:%s\r\n", uid);
+
+		strftime(start_date, MAX_NAME_LENGTH, "%Y%m%d",
+				new_date);
+
+		/* Make the calendar entry last all day for now */
+		end_date_fields = *new_date;
+		end_date_fields.tm_mday += 1;
+		mktime(&end_date_fields);
+		strftime(end_date, MAX_NAME_LENGTH, "%Y%m%d",
+				&end_date_fields);
+
+		strftime(now_date, MAX_NAME_LENGTH, "%Y%m%dT%H%M%S",
+				now);
+		fprintf(out, "DTSTAMP:%s\r\n", now_date);
+		fprintf(out, "DTSTART;VALUE=DATE:%s\r\n", start_date);
+		fprintf(out, "DTEND;VALUE=DATE:%s\r\n", end_date);
+		fprintf(out, "SUMMARY:%s\r\n", item->cal_entry->summary);
+		fprintf(out, "DESCRIPTION:%s\r\n", item->cal_entry->description);
+		fprintf(out, "END:VEVENT\r\n");
+	}
+	fprintf(out, "END:VCALENDAR\r\n");
+}
+
+void print_by_month_calendar(FILE *out, struct date_list *head)
+{
+	int cur_month, cur_year;
+	struct tm *old_date = NULL;
+	struct tm *new_date;
+	struct date_list *item;
+	char string[MAX_NAME_LENGTH];
+
+	if (!head)
+		return;
+
+	new_date = head->cal_entry->date;
+	print_month_and_year(out, new_date);
+	cur_month = new_date->tm_mon;
+	cur_year = new_date->tm_year;
+
+	for (item = head; item != NULL; item = item->next) {
+		new_date = item->cal_entry->date;
+		if (cur_month != new_date->tm_mon ||
+				cur_year != new_date->tm_year) {
+			fprintf(out, "\n");
+			print_month_and_year(out, new_date);
+			cur_month = new_date->tm_mon;
+			cur_year = new_date->tm_year;
+		}
+		strftime(string, MAX_NAME_LENGTH, "%e (%a)",
+				new_date);
+		if (old_date == NULL ||
+				!dates_are_equal(old_date, new_date))
+			fprintf(out, "\n   %s: %s\n", string,
+					item->cal_entry->description);
+		else
+			fprintf(out, "             %s\n",
+					item->cal_entry->description);
+		old_date = new_date;
+	}
+}
+
+void free_date_list(struct date_list *head)
+{
+	struct date_list *next;
+
+	for (; head; head = next) {
+		next = head->next;
+		free(head->cal_entry->summary);
+		free(head->cal_entry->description);
+		free(head->cal_entry);
+		free(head);
+	}
+}
+
+int add_plant_to_calendars(FILE *out, struct plant *new_plant,
+		unsigned int calendar_bitmask, struct calendar_lists *lists)
+{
+	if (calendar_bitmask & BY_PLANT) {
+		fprintf(out, "\n");
+		print_action_dates(out, new_plant);
+		fprintf(out, "\n");
+	}
+	if (calendar_bitmask & (BY_MONTH | BY_WALL)) {
+		if (!add_indoor_plant_dates_to_list(new_plant,
+				&lists->action, 1))
+			return 0;
+		if (!add_direct_sown_plant_dates_to_list(new_plant,
+				&lists->action, 1))
+			return 0;
+	}
+	if (calendar_bitmask & BY_SPROUTING) {
+		if (!add_indoor_plant_dates_to_list(new_plant,
+				&lists->sprouting, 0))
+			return 0;
+		if (!add_direct_sown_plant_dates_to_list(new_plant,
+				&lists->sprouting, 0))
+			return 0;
+	}
+	if (calendar_bitmask & BY_HARVEST) {
+		if (!add_harvest_dates_to_list(new_plant,
+				&lists->harvest))
+			return 0;
+	}
+	return 1;
+}
+
+void print_calendars(FILE *out, struct calendar_lists *lists,
+		unsigned int calendar_bitmask, int use_ical)
+{
+	unsigned int chars_printed;
+
+	if (calendar_bitmask & BY_MONTH) {
+		if (use_ical)
+			make_icalendar(out, lists->action);
+		else {
+			chars_printed = fprintf(out, "\n\nGarden Action Items Calendar\n");
+			for(; chars_printed > 3; chars_printed--)
+				fputc('*', out);
+			fprintf(out, "\n");
+			print_by_month_calendar(out, lists->action);
+		}
+	}
+
+	if (calendar_bitmask & BY_SPROUTING) {
+		if (use_ical)
+			make_icalendar(out, lists->sprouting);
+		else {
+			chars_printed = fprintf(out, "\n\nSeed Sprouting Calendar\n");
+			for(; chars_printed > 3; chars_printed--)
+				fputc('*', out);
+			fprintf(out, "\n");
+			print_by_month_calendar(out, lists->sprouting);
+		}
+	}
+
+	if (calendar_bitmask & BY_HARVEST) {
+		if (use_ical)
+			make_icalendar(out, lists->harvest);
+		else {
+			chars_printed = fprintf(out, "\n\nHarvest Calendar\n");
+			for(; chars_printed > 3; chars_printed--)
+				fputc('*', out);
+			fprintf(out, "\n");
+			print_by_month_calendar(out, lists->harvest);
+		}
+	}
+}
+
+void free_calendar_lists(struct calendar_lists *lists)
+{
+	free_date_list(lists->action);
+	free_date_list(lists->sprouting);
+	free_date_list(lists->harvest);
+	memset(lists, 0, sizeof(*lists));
+}
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "gardengeek.h"
+
+/****************** Variety catalog functions ******************/
+
+/* 64-bit FNV-1a hash of the first len characters of the name */
+uint64_t hash_name(const char *name, size_t len)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char) name[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/*
+ * Mix the name hash with the bucket's displacement to pick a slot.
+ * Only the name hash is computed per lookup; trying a new displacement
+ * while building the index doesn't need to rehash the name.
+ */
+static unsigned int displace_hash(uint64_t hash, unsigned int displacement,
+		unsigned int num_slots)
+{
+	hash ^= displacement * 0x9e3779b97f4a7c15ULL;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return hash % num_slots;
+}
+
+static struct variety *find_variety(struct variety_catalog *catalog,
+		const char *name, size_t len)
+{
+	struct variety *variety;
+	uint64_t hash;
+	unsigned int displacement;
+
+	if (!catalog)
+		return NULL;
+
+	hash = hash_name(name, len);
+	displacement = catalog->displacements[hash % catalog->num_buckets];
+	variety = &catalog->varieties[displace_hash(hash, displacement,
+			catalog->num_slots)];
+	if (!variety->name || strncmp(variety->name, name, len) ||
+			variety->name[len] != '\0')
+		return NULL;
+	return variety;
+}
+
+/*
+ * Garden rows can be labeled "tomato (2nd)" or "tomato (ovw)".  This is
+ * how much of the name is left without the trailing note.
+ */
+size_t get_variety_name_length(const char *name)
+{
+	size_t len = strlen(name);
+
+	if (len == 0 || name[len - 1] != ')')
+		return len;
+	for (; len > 1; len--) {
+		if (name[len - 2] == ' ' && name[len - 1] == '(')
+			return len - 2;
+	}
+	return strlen(name);
+}
+
+/* Look for the whole name first, and then for it without a trailing note */
+struct variety *find_variety_for_plant(struct variety_catalog *catalog,
+		const char *name)
+{
+	struct variety *variety;
+	size_t len = strlen(name);
+	size_t variety_len;
+
+	variety = find_variety(catalog, name, len);
+	variety_len = get_variety_name_length(name);
+	if (variety || variety_len == len)
+		return variety;
+	return find_variety(catalog, name, variety_len);
+}
+
+#define MAX_DISPLACEMENT	(1 << 16)
+
+struct hashed_variety {
+	uint64_t	hash;
+	unsigned int	bucket;
+	struct variety	*variety;
+};
+
+static int compare_hashed_varieties(const void *this, const void *that)
+{
+	const struct hashed_variety *a = this;
+	const struct hashed_variety *b = that;
+
+	if (a->bucket != b->bucket)
+		return a->bucket < b->bucket ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Try to find a displacement for every bucket, starting with the biggest
+ * buckets (they're the hardest to fit).  The hashed list must be sorted by
+ * bucket.  Returns 0 if some bucket couldn't be placed, so the caller can
+ * try again with more slots.
+ */
+static int place_buckets(struct variety_catalog *catalog,
+		struct hashed_variety *hashed,
+		unsigned int *bucket_start, unsigned int *bucket_order,
+		unsigned char *taken, unsigned int *slots)
+{
+	unsigned int i, j, k, b, d;
+	unsigned int start, size;
+
+	memset(taken, 0, catalog->num_slots);
+	for (i = 0; i < catalog->num_buckets; i++) {
+		b = bucket_order[i];
+		start = bucket_start[b];
+		size = bucket_start[b + 1] - start;
+		catalog->displacements[b] = 0;
+		if (!size)
+			continue;
+
+		for (d = 0; d < MAX_DISPLACEMENT; d++) {
+			for (j = 0; j < size; j++) {
+				slots[j] = displace_hash(hashed[start + j].hash,
+						d, catalog->num_slots);
+				if (taken[slots[j]])
+					break;
+				for (k = 0; k < j; k++)
+					if (slots[k] == slots[j])
+						break;
+				if (k != j)
+					break;
+			}
+			if (j == size)
+				break;
+		}
+		if (d == MAX_DISPLACEMENT)
+			return 0;
+
+		catalog->displacements[b] = d;
+		for (j = 0; j < size; j++) {
+			taken[slots[j]] = 1;
+			catalog->varieties[slots[j]] = *hashed[start + j].variety;
+		}
+	}
+	return 1;
+}
+
+static unsigned int *sort_buckets_by_size(unsigned int *bucket_start,
+		unsigned int num_buckets)
+{
+	unsigned int *order;
+	unsigned int *count;
+	unsigned int i, size, max_size = 0;
+
+	order = malloc(sizeof(*order)*num_buckets);
+	if (!order)
+		return NULL;
+	for (i = 0; i < num_buckets; i++) {
+		size = bucket_start[i + 1] - bucket_start[i];
+		if (size > max_size)
+			max_size = size;
+	}
+	count = calloc(max_size + 2, sizeof(*count));
+	if (!count) {
+		free(order);
+		return NULL;
+	}
+	/* Counting sort, biggest bucket first */
+	for (i = 0; i < num_buckets; i++)
+		count[max_size - (bucket_start[i + 1] - bucket_start[i]) + 1]++;
+	for (i = 1; i <= max_size + 1; i++)
+		count[i] += count[i - 1];
+	for (i = 0; i < num_buckets; i++)
+		order[count[max_size - (bucket_start[i + 1] - bucket_start[i])]++] = i;
+	free(count);
+	return order;
+}
+
+/*
+ * Build the perfect hash for the list of varieties using the
+ * "hash, displace, and compress" idea: hash every name into a small number
+ * of buckets, and then for each bucket search for a displacement that moves
+ * all its names into empty slots.
+ */
+static int build_variety_index(struct variety_catalog *catalog,
+		struct variety *list, unsigned int num_varieties,
+		struct garden_error *error)
+{
+	struct hashed_variety *hashed;
+	unsigned int *bucket_start = NULL;
+	unsigned int *bucket_order = NULL;
+	unsigned int *slots = NULL;
+	unsigned char *taken = NULL;
+	unsigned int i, j, max_size = 0;
+	int ret = 0;
+
+	catalog->num_buckets = num_varieties/4 + 1;
+	catalog->num_slots = num_varieties + num_varieties/4 + 1;
+
+	hashed = malloc(sizeof(*hashed)*(num_varieties + 1));
+	bucket_start = calloc(catalog->num_buckets + 1, sizeof(*bucket_start));
+	catalog->displacements = malloc(sizeof(*catalog->displacements)*
+			catalog->num_buckets);
+	set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+	if (!hashed || !bucket_start || !catalog->displacements)
+		goto out;
+
+	for (i = 0; i < num_varieties; i++) {
+		hashed[i].hash = hash_name(list[i].name, strlen(list[i].name));
+		hashed[i].bucket = hashed[i].hash % catalog->num_buckets;
+		hashed[i].variety = &list[i];
+	}
+	qsort(hashed, num_varieties, sizeof(*hashed), compare_hashed_varieties);
+	for (i = 0; i < num_varieties; i++)
+		bucket_start[hashed[i].bucket + 1]++;
+	for (i = 0; i < catalog->num_buckets; i++) {
+		if (bucket_start[i + 1] > max_size)
+			max_size = bucket_start[i + 1];
+		bucket_start[i + 1] += bucket_start[i];
+	}
+
+	/* Two varieties with the same name would never fit. */
+	for (i = 0; i < num_varieties; i++) {
+		for (j = i + 1; j < num_varieties &&
+				hashed[j].bucket == hashed[i].bucket; j++) {
+			if (hashed[i].hash == hashed[j].hash &&
+					!strcmp(hashed[i].variety->name,
+						hashed[j].variety->name)) {
+				set_garden_error(error,
+						GARDEN_DUPLICATE_VARIETY,
+						hashed[i].variety->name);
+				goto out;
+			}
+		}
+	}
+
+	bucket_order = sort_buckets_by_size(bucket_start,
+			catalog->num_buckets);
+	slots = malloc(sizeof(*slots)*(max_size + 1));
+	if (!bucket_order || !slots)
+		goto out;
+
+	/* Rarely, a bucket won't fit.  Spread the names out and retry. */
+	while (1) {
+		catalog->varieties = calloc(catalog->num_slots,
+				sizeof(*catalog->varieties));
+		taken = malloc(catalog->num_slots);
+		if (!catalog->varieties || !taken)
+			goto out;
+		if (place_buckets(catalog, hashed, bucket_start, bucket_order,
+					taken, slots))
+			break;
+		free(catalog->varieties);
+		free(taken);
+		catalog->varieties = NULL;
+		taken = NULL;
+		catalog->num_slots += catalog->num_slots/4 + 1;
+	}
+	ret = 1;
+out:
+	free(hashed);
+	free(bucket_start);
+	free(bucket_order);
+	free(slots);
+	free(taken);
+	return ret;
+}
+
+/*
+ * Rows can end with the number of square feet each plant needs
+ * in a garden bed.  Plants without one get a square foot.
+ */
+void read_optional_spacing(FILE *fp, float *square_feet_per_plant)
+{
+	fscanf(fp, "%f", square_feet_per_plant);
+	fgetc(fp);
+}
+
+static struct variety *parse_variety(FILE *fp, struct variety *new_variety)
+{
+	memset(new_variety, 0, sizeof(*new_variety));
+
+	if (!skip_comment_lines(fp))
+		return NULL;
+
+	if (!copy_word_from_file(fp, &new_variety->name))
+		return NULL;
+
+	fscanf(fp, "%u", &new_variety->num_weeks_indoors);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->num_weeks_until_indoor_separation);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->num_weeks_until_outdoor_separation);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->days_to_harvest);
+	fgetc(fp);
+
+	fscanf(fp, "%f", &new_variety->germination_rate);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->min_days_to_sprout);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->max_days_to_sprout);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_variety->harvest_removes_plant);
+	if (fgetc(fp) == ',')
+		read_optional_spacing(fp, &new_variety->square_feet_per_plant);
+
+	return new_variety;
+}
+
+struct variety_catalog *load_variety_catalog(FILE *fp,
+		struct garden_error *error)
+{
+	struct variety_catalog *catalog;
+	struct variety *list = NULL;
+	struct variety *tmp;
+	unsigned int num_varieties = 0;
+	unsigned int list_size = 0;
+
+	catalog = malloc(sizeof(*catalog));
+	if (!catalog) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return NULL;
+	}
+	memset(catalog, 0, sizeof(*catalog));
+
+	while (1) {
+		if (num_varieties == list_size) {
+			list_size = list_size ? list_size*2 : 64;
+			tmp = realloc(list, sizeof(*list)*list_size);
+			if (!tmp) {
+				set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+				goto fail;
+			}
+			list = tmp;
+		}
+		if (!parse_variety(fp, &list[num_varieties]))
+			break;
+		num_varieties++;
+	}
+
+	if (!build_variety_index(catalog, list, num_varieties, error))
+		goto fail;
+	/* The index has its own copy of each variety; the names are shared. */
+	free(list);
+	return catalog;
+
+fail:
+	while (num_varieties)
+		free(list[--num_varieties].name);
+	free(list);
+	free(catalog->varieties);
+	free(catalog->displacements);
+	free(catalog);
+	return NULL;
+}
+
+void free_variety_catalog(struct variety_catalog *catalog)
+{
+	unsigned int i;
+
+	for (i = 0; i < catalog->num_slots; i++)
+		free(catalog->varieties[i].name);
+	free(catalog->varieties);
+	free(catalog->displacements);
+	free(catalog);
+}
+
+/* Fill in everything a short garden row leaves out from its variety */
+void inherit_variety(struct plant *new_plant, struct variety *variety)
+{
+	new_plant->num_weeks_indoors = variety->num_weeks_indoors;
+	new_plant->num_weeks_until_indoor_separation =
+		variety->num_weeks_until_indoor_separation;
+	new_plant->num_weeks_until_outdoor_separation =
+		variety->num_weeks_until_outdoor_separation;
+	new_plant->days_to_harvest = variety->days_to_harvest;
+	new_plant->germination_rate = variety->germination_rate;
+	new_plant->min_days_to_sprout = variety->min_days_to_sprout;
+	new_plant->max_days_to_sprout = variety->max_days_to_sprout;
+	new_plant->harvest_removes_plant = variety->harvest_removes_plant;
+	new_plant->square_feet_per_plant = variety->square_feet_per_plant;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gardengeek.h"
+
+/*
+ * Days since 1970-01-01.  Plain integer math on the calendar fields,
+ * so it doesn't depend on the time zone the way mktime() does.
+ */
+int date_to_day_number(struct tm *date)
+{
+	int year = date->tm_year + 1900;
+	int month = date->tm_mon + 1;
+	int era, year_of_era, day_of_year, day_of_era;
+
+	if (month <= 2)
+		year--;
+	era = (year >= 0 ? year : year - 399) / 400;
+	year_of_era = year - era * 400;
+	day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 +
+		date->tm_mday - 1;
+	day_of_era = year_of_era * 365 + year_of_era / 4 -
+		year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+/* The reverse of date_to_day_number(), good enough for strftime() */
+void day_number_to_date(int day_number, struct tm *date)
+{
+	int era, day_of_era, year_of_era, day_of_year, mp;
+	int year, month, day;
+	struct tm jan_first;
+
+	day_number += 719468;
+	era = (day_number >= 0 ? day_number : day_number - 146096) / 146097;
+	day_of_era = day_number - era * 146097;
+	year_of_era = (day_of_era - day_of_era / 1460 +
+			day_of_era / 36524 - day_of_era / 146096) / 365;
+	year = year_of_era + era * 400;
+	day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 -
+			year_of_era / 100);
+	mp = (5 * day_of_year + 2) / 153;
+	day = day_of_year - (153 * mp + 2) / 5 + 1;
+	month = mp < 10 ? mp + 3 : mp - 9;
+	if (month <= 2)
+		year++;
+
+	memset(date, 0, sizeof(*date));
+	date->tm_year = year - 1900;
+	date->tm_mon = month - 1;
+	date->tm_mday = day;
+	date->tm_isdst = -1;
+
+	memset(&jan_first, 0, sizeof(jan_first));
+	jan_first.tm_year = date->tm_year;
+	jan_first.tm_mday = 1;
+	/* 1970-01-01 was a Thursday */
+	date->tm_wday = ((day_number - 719468) % 7 + 11) % 7;
+	date->tm_yday = (day_number - 719468) -
+		date_to_day_number(&jan_first);
+}
+
+
+static int add_days_to_date(struct tm *date, int days)
+{
+	date->tm_mday += days;
+	/* Normalize the date */
+	mktime(date);
+	return 0;
+}
+
+static int calculate_indoor_plant_dates(struct plant *new_plant)
+{
+	int ret;
+	unsigned int temp;
+
+	/* Get date to start seeds indoors */
+	new_plant->seeding_date = new_plant->outdoor_planting_date;
+	ret = add_days_to_date(&new_plant->seeding_date,
+			-(new_plant->num_weeks_indoors)*7);
+	if (ret)
+		return ret;
+
+	/* Get date to separate indoor seedlings */
+	if (new_plant->num_weeks_until_indoor_separation) {
+		new_plant->indoor_separation_date =
+			new_plant->seeding_date;
+		temp = new_plant->num_weeks_until_indoor_separation*7;
+		ret = add_days_to_date(
+				&new_plant->indoor_separation_date,
+			       	temp);
+		if (ret)
+			return ret;
+	}
+
+	/* Get date to start hardening off plants (leaving them
+	 * outdoors during the day, bringing them inside at night)
+	 */
+	new_plant->hardening_off_date =
+		new_plant->outdoor_planting_date;
+	ret = add_days_to_date(&new_plant->hardening_off_date, -3);
+	if (ret)
+		return ret;
+
+	/* Set sprouting base date */
+	new_plant->sprouting_date = new_plant->seeding_date;
+	new_plant->last_chance_sprouting_date = new_plant->seeding_date;
+	return 0;
+}
+
+static int calculate_direct_sown_plant_dates(struct plant *new_plant)
+{
+	int ret;
+	int temp;
+
+	new_plant->seeding_date = new_plant->outdoor_planting_date;
+	
+	new_plant->sprouting_date =
+		new_plant->outdoor_planting_date;
+	new_plant->last_chance_sprouting_date =
+		new_plant->outdoor_planting_date;
+	
+	if (new_plant->num_weeks_until_outdoor_separation) {
+		new_plant->outdoor_separation_date =
+			new_plant->outdoor_planting_date;
+		temp = new_plant->num_weeks_until_outdoor_separation;
+		ret = add_days_to_date(
+				&new_plant->outdoor_separation_date,
+				temp*7);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+int calculate_plant_dates(struct plant *new_plant)
+{
+	int ret;
+
+	/* Some plants need to be direct sown outdoors,
+	 * rather than started under a sun lamp indoors.
+	 */
+	if (new_plant->num_weeks_indoors) {
+		ret = calculate_indoor_plant_dates(new_plant);
+	} else {
+		ret = calculate_direct_sown_plant_dates(new_plant);
+	}
+	if (ret)
+		return ret;
+
+	ret = add_days_to_date(&new_plant->sprouting_date,
+			(int) new_plant->avg_days_to_sprout);
+	if (ret)
+		return ret;
+
+	ret = add_days_to_date(&new_plant->last_chance_sprouting_date,
+			new_plant->max_days_to_sprout);
+	if (ret)
+		return ret;
+
+	/* Harvest date is calculated from the time the seed is in the soil,
+	 * either indoors or outdoors.
+	 */
+	new_plant->harvest_date = new_plant->seeding_date;
+	ret = add_days_to_date(&new_plant->harvest_date,
+			new_plant->days_to_harvest);
+	if (ret)
+		return ret;
+
+	return 0;
+}
+
+/* When the seeds go in, without working out all the other dates */
+int get_seeding_day(struct plant *new_plant)
+{
+	return date_to_day_number(&new_plant->outdoor_planting_date) -
+		7*new_plant->num_weeks_indoors;
+}
+
+/*
+ * Redo just the sprouting dates, for when what's known about how long the
+ * seeds take to come up changes after the rest of the dates are worked out.
+ */
+void calculate_sprouting_dates(struct plant *new_plant)
+{
+	int day = date_to_day_number(&new_plant->seeding_date);
+
+	day_number_to_date(day + (int) new_plant->avg_days_to_sprout,
+			&new_plant->sprouting_date);
+	day_number_to_date(day + new_plant->max_days_to_sprout,
+			&new_plant->last_chance_sprouting_date);
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+#include "gardengeek.h"
+
+static const char *garden_error_strings[] = {
+	[GARDEN_OK] = "No error",
+	[GARDEN_NO_MEMORY] = "Out of memory",
+	[GARDEN_BAD_FILE] = "Couldn't open file",
+	[GARDEN_BAD_DATE] = "Bad date",
+	[GARDEN_DUPLICATE_VARIETY] = "Duplicate variety in catalog",
+	[GARDEN_UNKNOWN_VARIETY] = "No variety in the catalog",
+	[GARDEN_EMPTY_FILE] = "Nothing in file",
+	[GARDEN_NO_CONNECTION] = "Couldn't connect",
+	[GARDEN_NO_FONTS] = "Couldn't set up calendar fonts",
+	[GARDEN_NO_DRAWING] = "Couldn't draw the wall calendar",
+	[GARDEN_BAD_SEED_COUNT] = "More seeds came up than were sown",
+};
+
+const char *garden_strerror(enum garden_error_code code)
+{
+	if (code >= sizeof(garden_error_strings)/
+			sizeof(garden_error_strings[0]))
+		return "Unknown error";
+	return garden_error_strings[code];
+}
+
+void set_garden_error(struct garden_error *error,
+		enum garden_error_code code, const char *what)
+{
+	if (!error)
+		return;
+	error->code = code;
+	error->what[0] = '\0';
+	if (what)
+		snprintf(error->what, sizeof(error->what), "%s", what);
+}
+
+void print_garden_error(FILE *out, struct garden_error *error)
+{
+	if (error->what[0])
+		fprintf(out, "%s: %s\n", garden_strerror(error->code),
+				error->what);
+	else
+		fprintf(out, "%s\n", garden_strerror(error->code));
+}
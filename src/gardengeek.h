@@ -0,0 +1,410 @@
+/*
+ * libgardengeek: garden calendars, bed plans, and reminders.
+ *
+ * Nothing in the library prints or exits.  Functions that read take a
+ * FILE *, and functions that write take the FILE * to write to, so a
+ * caller can hand them a file, a pipe, a socket, or a buffer in memory
+ * (fmemopen(), open_memstream(), or fopencookie() for anything else).
+ * Functions that can fail for more than one reason say why in the
+ * struct garden_error they're given, if they're given one.  Everything
+ * the library makes or loads has a free_*() or close_*() function to go
+ * with it, so it can run inside a long-lived service.
+ *
+ * There's no global state: different threads can work on different
+ * gardens at the same time.  A variety catalog is only read once it's
+ * loaded, and schedule caches and sprouting statistics do their own
+ * locking, so all of them can be shared between threads.
+ */
+#ifndef GARDENGEEK_H
+#define GARDENGEEK_H
+
+#include <stdio.h>
+#include <time.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Names and other words read from files are cut short to fit in this */
+#define MAX_NAME_LENGTH	500
+/* The widest field scanf() can read into a MAX_NAME_LENGTH buffer */
+#define MAX_NAME_FIELD	"499"
+
+/*
+ * Templates that work in any climate say when to plant relative to the
+ * last frost, like "+14" or "-7".  Until there's a region to go with them,
+ * those rows are planted relative to REFERENCE_LAST_FROST.
+ */
+#define REFERENCE_LAST_FROST	10957	/* 2000-01-01 */
+
+/* Which calendars and plans to make */
+#define	BY_PLANT	(1 << 0)
+#define	BY_MONTH	(1 << 1)
+#define	BY_HARVEST	(1 << 2)
+#define	BY_SPROUTING	(1 << 3)
+#define	BY_BED		(1 << 4)
+#define	BY_GROWTH	(1 << 5)
+#define	BY_WALL		(1 << 6)
+#define	BY_REMINDER	(1 << 7)
+#define	BY_REGION	(1 << 8)
+#define	BY_SEED_ORDER	(1 << 9)
+
+enum garden_error_code {
+	GARDEN_OK = 0,
+	GARDEN_NO_MEMORY,
+	GARDEN_BAD_FILE,
+	GARDEN_BAD_DATE,
+	GARDEN_DUPLICATE_VARIETY,
+	GARDEN_UNKNOWN_VARIETY,
+	GARDEN_EMPTY_FILE,
+	GARDEN_NO_CONNECTION,
+	GARDEN_NO_FONTS,
+	GARDEN_NO_DRAWING,
+	GARDEN_BAD_SEED_COUNT,
+};
+
+struct garden_error {
+	enum garden_error_code	code;
+	/* The plant, variety, region, or file it went wrong with, if any */
+	char			what[MAX_NAME_LENGTH];
+};
+
+
+struct plant {
+	/* input */
+	char		*name;
+	unsigned int	num_plants_to_harvest;
+	unsigned int	num_weeks_indoors;
+	unsigned int	num_weeks_until_indoor_separation;
+	struct tm	outdoor_planting_date;
+	/* or, for rows like "+14", days after the region's last frost */
+	unsigned int	relative_to_last_frost;
+	int		days_after_last_frost;
+	unsigned int	num_weeks_until_outdoor_separation;
+	unsigned int	days_to_harvest;
+	float		germination_rate;
+	unsigned int	min_days_to_sprout;
+	float		avg_days_to_sprout;
+	unsigned int	max_days_to_sprout;
+	unsigned int	harvest_removes_plant; /* 0 = false; non-zero = true */
+	float		square_feet_per_plant; /* optional, defaults to 1 */
+	/* output */
+	/* XXX: These could be an array with an enum. */
+	struct tm	seeding_date;
+	struct tm	sprouting_date;
+	struct tm	last_chance_sprouting_date;
+	struct tm	indoor_separation_date;
+	struct tm	hardening_off_date;
+	struct tm	outdoor_separation_date;
+	struct tm	harvest_date;
+};
+
+/* The parts of a plant row that only depend on the variety,
+ * so a garden row can just say "tomato,4,2010-05-01".
+ */
+struct variety {
+	char		*name;
+	unsigned int	num_weeks_indoors;
+	unsigned int	num_weeks_until_indoor_separation;
+	unsigned int	num_weeks_until_outdoor_separation;
+	unsigned int	days_to_harvest;
+	float		germination_rate;
+	unsigned int	min_days_to_sprout;
+	unsigned int	max_days_to_sprout;
+	unsigned int	harvest_removes_plant;
+	float		square_feet_per_plant;
+};
+
+/*
+ * Varieties are stored in the slot picked by a perfect hash of their name,
+ * so looking one up is one hash of the name, one array index, and one string
+ * compare.  Slots that no variety hashed into have a NULL name.
+ */
+struct variety_catalog {
+	struct variety	*varieties;
+	unsigned int	num_slots;
+	unsigned int	*displacements;
+	unsigned int	num_buckets;
+};
+
+struct plant_date {
+	struct tm	*date;
+	char		*summary;
+	char		*description;
+};
+
+struct date_list {
+	struct plant_date	*cal_entry;
+	struct date_list	*next;
+};
+
+/* All the plants in a garden, for outputs that need to see them at once */
+struct plant_list {
+	struct plant	**plants;
+	unsigned int	num_plants;
+	unsigned int	list_size;
+};
+
+/* The calendars a garden's plants are sorted into */
+struct calendar_lists {
+	struct date_list	*sprouting;
+	struct date_list	*action;
+	struct date_list	*harvest;
+};
+
+struct garden_bed {
+	char		*name;
+	float		square_feet;
+	float		square_feet_free;
+};
+
+struct region {
+	char		*name;
+	int		last_frost_day;
+};
+
+/*
+ * A hash table keyed by a name and a number, like a variety and a week.
+ * Each kind of entry in it starts with a struct name_entry.
+ */
+struct name_entry {
+	uint64_t	hash;
+	char		*name;		/* NULL for an empty slot */
+	int		number;
+};
+
+struct name_table {
+	char		*entries;
+	size_t		entry_size;
+	unsigned int	num_slots;
+	unsigned int	num_entries;
+};
+
+/* Everything in a plant row that its dates and calendar entries depend on */
+struct schedule_key {
+	unsigned int	num_plants_to_harvest;
+	unsigned int	num_weeks_indoors;
+	unsigned int	num_weeks_until_indoor_separation;
+	int		outdoor_planting_day;
+	unsigned int	num_weeks_until_outdoor_separation;
+	unsigned int	days_to_harvest;
+	float		germination_rate;
+	unsigned int	min_days_to_sprout;
+	float		avg_days_to_sprout;
+	unsigned int	max_days_to_sprout;
+	unsigned int	harvest_removes_plant;
+};
+
+struct schedule_event {
+	int		day;
+	char		*summary;
+	char		*description;
+};
+
+/* A plant row's dates, and its action items and harvest dates in order */
+struct schedule {
+	uint64_t		hash;
+	char			*name;
+	struct schedule_key	key;
+	struct plant		dates;	/* only the output dates are used */
+	struct schedule_event	*events;
+	unsigned int		num_events;
+	unsigned int		refcount;
+	struct schedule		*next;	/* in its hash bucket */
+	struct schedule		*lru_prev;
+	struct schedule		*lru_next;
+};
+
+struct schedule_cache;
+
+struct sprout_stats;
+
+struct garden;
+
+struct reminder {
+	struct reminder		*next;		/* in its wheel slot */
+	struct reminder		**pprev;
+	struct reminder		*garden_next;	/* in its garden's list */
+	struct reminder		**garden_pprev;
+	struct garden		*garden;
+	unsigned int		day;
+	struct schedule		*schedule;	/* holds these strings */
+	char			*summary;
+	char			*description;
+};
+
+struct garden {
+	char			*name;
+	uint64_t		hash;
+	struct garden		*next;		/* in its hash bucket */
+	struct reminder		*reminders;
+};
+
+/*
+ * Where due reminders go.  Sinks that stand in for SMS or email just need
+ * a send and a flush function; the stream sink writes a line per reminder
+ * to stdout, a file, or a local socket.  Both return 0 if the reminders
+ * couldn't be sent, and the sink is marked failed and isn't used again.
+ */
+struct reminder_sink {
+	int		(*send)(struct reminder_sink *sink,
+				struct reminder *reminder);
+	int		(*flush)(struct reminder_sink *sink);
+	FILE		*fp;
+	int		failed;
+};
+
+struct reminder_wheel;
+
+/* error.c */
+const char *garden_strerror(enum garden_error_code code);
+void set_garden_error(struct garden_error *error,
+		enum garden_error_code code, const char *what);
+void print_garden_error(FILE *out, struct garden_error *error);
+
+/* parse.c */
+int skip_comment_lines(FILE *fp);
+int copy_word_from_file(FILE *fp, char **new_word);
+char *copy_string(char *string);
+struct plant *parse_and_create_plant(FILE *fp,
+		struct variety_catalog *catalog, struct garden_error *error);
+void free_plant(struct plant *new_plant);
+int add_plant_to_list(struct plant_list *list, struct plant *new_plant);
+void free_plant_list(struct plant_list *list);
+
+/* catalog.c */
+uint64_t hash_name(const char *name, size_t len);
+size_t get_variety_name_length(const char *name);
+struct variety *find_variety_for_plant(struct variety_catalog *catalog,
+		const char *name);
+void read_optional_spacing(FILE *fp, float *square_feet_per_plant);
+void inherit_variety(struct plant *new_plant, struct variety *variety);
+struct variety_catalog *load_variety_catalog(FILE *fp,
+		struct garden_error *error);
+void free_variety_catalog(struct variety_catalog *catalog);
+
+/* name-table.c */
+void init_name_table(struct name_table *table, size_t entry_size);
+void free_name_table(struct name_table *table);
+struct name_entry *get_name_table_slot(struct name_table *table,
+		unsigned int slot);
+struct name_entry *find_name_entry(struct name_table *table,
+		const char *name, size_t len, int number);
+struct name_entry *add_name_entry(struct name_table *table,
+		const char *name, size_t len, int number);
+
+/* dates.c */
+int date_to_day_number(struct tm *date);
+void day_number_to_date(int day_number, struct tm *date);
+int calculate_plant_dates(struct plant *new_plant);
+int get_seeding_day(struct plant *new_plant);
+void calculate_sprouting_dates(struct plant *new_plant);
+
+/* calendar.c */
+float get_num_seeds_needed(struct plant *new_plant);
+void print_action_dates(FILE *out, struct plant *new_plant);
+int add_indoor_plant_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr, int suppress_sprouting_dates);
+int add_direct_sown_plant_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr, int suppress_sprouting_dates);
+int add_harvest_dates_to_list(struct plant *new_plant,
+		struct date_list **head_ptr);
+void free_date_list(struct date_list *head);
+void make_icalendar(FILE *out, struct date_list *head);
+void print_by_month_calendar(FILE *out, struct date_list *head);
+int add_plant_to_calendars(FILE *out, struct plant *new_plant,
+		unsigned int calendar_bitmask, struct calendar_lists *lists);
+void print_calendars(FILE *out, struct calendar_lists *lists,
+		unsigned int calendar_bitmask, int use_ical);
+void free_calendar_lists(struct calendar_lists *lists);
+
+/* wall-calendar.c, only in a libgardengeek built with cairo */
+#ifdef HAVE_CAIRO
+struct wall_calendar_fonts;
+
+struct wall_calendar_fonts *make_wall_calendar_fonts(
+		struct garden_error *error);
+void free_wall_calendar_fonts(struct wall_calendar_fonts *fonts);
+int make_wall_calendar(struct date_list *head, char *filename,
+		struct wall_calendar_fonts *fonts, struct garden_error *error);
+#endif
+
+/* beds.c */
+int get_outdoor_start_day(struct plant *new_plant);
+int get_outdoor_end_day(struct plant *new_plant);
+struct garden_bed *load_garden_beds(FILE *fp, unsigned int *num_beds,
+		struct garden_error *error);
+void free_garden_beds(struct garden_bed *beds, unsigned int num_beds);
+int allocate_garden_beds(struct plant **plants, unsigned int num_plants,
+		struct garden_bed *beds, unsigned int num_beds,
+		int *plant_beds);
+void print_bed_allocation(FILE *out, struct plant **plants,
+		unsigned int num_plants, struct garden_bed *beds,
+		unsigned int num_beds, int *plant_beds);
+
+/* growth.c */
+int print_growth_simulation(FILE *out, struct plant **plants,
+		unsigned int num_plants);
+
+/* schedule-cache.c */
+#define SCHEDULE_CACHE_ENTRIES	65536
+
+struct schedule_cache *make_schedule_cache(unsigned int max_entries);
+void free_schedule_cache(struct schedule_cache *cache);
+struct schedule *get_schedule(struct schedule_cache *cache,
+		struct plant *new_plant);
+void hold_schedule(struct schedule_cache *cache, struct schedule *schedule);
+void put_schedule(struct schedule_cache *cache, struct schedule *schedule);
+void get_schedule_cache_stats(struct schedule_cache *cache,
+		unsigned long *hits, unsigned long *misses,
+		unsigned long *evictions);
+void print_schedule_cache_stats(FILE *out, struct schedule_cache *cache);
+
+/* reminder.c */
+struct reminder_wheel *make_reminder_wheel(struct reminder_sink **sinks,
+		unsigned int num_sinks, unsigned int today);
+void free_reminder_wheel(struct reminder_wheel *wheel);
+int add_garden(struct reminder_wheel *wheel, char *name, FILE *fp,
+		struct variety_catalog *catalog, struct sprout_stats *stats,
+		struct garden_error *error);
+void remove_garden(struct reminder_wheel *wheel, char *name);
+void run_reminders_until(struct reminder_wheel *wheel, unsigned int day);
+struct reminder_sink *make_reminder_sink(char *name,
+		struct garden_error *error);
+int close_reminder_sink(struct reminder_sink *sink);
+int run_reminder_scheduler(FILE *fp, FILE *log,
+		struct reminder_sink **sinks, unsigned int num_sinks,
+		struct variety_catalog *catalog, struct sprout_stats *stats);
+
+/* region.c */
+struct region *load_regions(FILE *fp, unsigned int *num_regions,
+		struct garden_error *error);
+void free_regions(struct region *regions, unsigned int num_regions);
+int make_region_calendars(FILE *out, struct plant_list *garden,
+		struct region *regions, unsigned int num_regions,
+		unsigned int calendar_bitmask, int use_ical,
+		struct sprout_stats *stats);
+
+/* seed-order.c */
+int print_seed_order(FILE *out, FILE *log, char **filenames,
+		unsigned int num_files, struct variety_catalog *catalog,
+		struct sprout_stats *stats, unsigned long *num_skipped,
+		struct garden_error *error);
+
+/* sprout-stats.c */
+struct sprout_stats *make_sprout_stats(void);
+void free_sprout_stats(struct sprout_stats *stats);
+int add_sprout_observation(struct sprout_stats *stats, const char *variety,
+		const char *region, unsigned int seeds_sown,
+		unsigned int seeds_sprouted, int days_to_sprout);
+int load_sprout_observations(struct sprout_stats *stats, FILE *fp,
+		struct garden_error *error);
+int use_sprout_stats(struct sprout_stats *stats, struct plant *new_plant,
+		const char *region);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GARDENGEEK_H */
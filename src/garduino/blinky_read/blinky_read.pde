@@ -2,9 +2,13 @@
  * Blinky read
  * Copyright (C) 2010 Sarah Sharp
  *
- * Read the analog to digital converter every second,
- * output the results, and turn on an LED if
+ * Read the analog to digital converter for each moisture sensor,
+ * send the results, and turn on that sensor's pump (and the LED) if
  * the voltage drops below a specific threshold.
+ *
+ * Nothing in loop() waits.  Each pass checks millis() to see whether it's
+ * time to take the next sample, turn off a pump, or send telemetry, so the
+ * sensors keep being read while the pumps run.
  */
 
 /* Limitations on the amount of time to water,
@@ -13,69 +17,205 @@
  * and one small house
  plant, with the hose primed.
  */
-const unsigned long wateringMicrosecs = 500;
+const unsigned long wateringMillis = 500;
 
 /* Only water every 30 seconds */
-const unsigned long delaySecs = 30;
+#ifndef DELAY_SECS
+#define DELAY_SECS 30
+#endif
+const unsigned long delaySecs = DELAY_SECS;
 
 const int ledPin =  13;
-const int analogInPin = 0;
-const int pumpVccPin = 3;
+
+/*
+ * One zone is one moisture sensor and the pump that waters its plants.
+ * Add more zones by adding a sensor pin, pump pin, and threshold.
+ */
+#define NUM_ZONES 1
+const int analogInPins[NUM_ZONES] = { 0 };
+const int pumpVccPins[NUM_ZONES] = { 3 };
 /*
  * Max voltage measured is 5V, or 1023 from ADC.
  * Pick the voltage threshold to be half that.
+ * (The host replay build can override it to try out other thresholds.)
+ */
+#ifndef VOLTAGE_THRESHOLD
+#define VOLTAGE_THRESHOLD 795
+#endif
+const int voltageThresholds[NUM_ZONES] = { VOLTAGE_THRESHOLD };
+
+/* Take a sample from every sensor this often */
+const unsigned long sampleMillis = 2;
+
+/* Average this many samples (a power of two) to smooth out sensor noise */
+#define FILTER_SAMPLES 8
+
+/* Send a telemetry frame for each zone this often */
+const unsigned long telemetryMillis = 1000;
+
+/*
+ * Telemetry frame, sent little-endian instead of as text:
+ *   byte 0:    FRAME_START
+ *   byte 1:    zone number
+ *   byte 2:    flags (FRAME_PUMP_ON)
+ *   bytes 3-4: filtered reading, 0 to 1023
+ *   bytes 5-6: seconds until the zone may be watered again
+ *   byte 7:    xor of bytes 1 through 6
  */
-const int voltageThreshold = 795;
+#define FRAME_START   0xA5
+#define FRAME_PUMP_ON (1 << 0)
+#define FRAME_LENGTH  8
 
 /* Globals */
-unsigned long previousMillis = 0;  // will store last time LED was updated
+int samples[NUM_ZONES][FILTER_SAMPLES];
+long sampleSums[NUM_ZONES];
+int nextSample = 0;
+int samplesTaken = 0;
+
+boolean pumpOn[NUM_ZONES];
+unsigned long pumpStartMillis[NUM_ZONES];
+unsigned long previousMillis[NUM_ZONES];  // last time each zone was watered
+
+unsigned long lastSampleMillis = 0;
+unsigned long lastTelemetryMillis = 0;
 
 void setup() {
-  // set the digital pin as output:
+  int zone;
+  int i;
+
   pinMode(ledPin, OUTPUT);
-  pinMode(pumpVccPin, OUTPUT);
+  for (zone = 0; zone < NUM_ZONES; zone++) {
+    // set the digital pin as output:
+    pinMode(pumpVccPins[zone], OUTPUT);
+    pumpOn[zone] = false;
+    previousMillis[zone] = 0;
+    sampleSums[zone] = 0;
+    for (i = 0; i < FILTER_SAMPLES; i++)
+      samples[zone][i] = 0;
+  }
   Serial.begin(9600);
-  previousMillis = 0;
+  lastSampleMillis = millis();
+  lastTelemetryMillis = lastSampleMillis;
 }
 
-/* Turn on the pump for wateringMicrosecs.
- * Refuse to water more often than delayMicrosecs.
- */
-void waterPlant()
+/* 0 to 1023, representing 0 to 5V, averaged over the last few samples */
+int filteredVoltage(int zone)
 {
-  unsigned long currentMillis;
-  unsigned long secondsLeft;
-  
-  currentMillis = millis();
-  if ((currentMillis - previousMillis) / 1000 <= delaySecs) {
-    secondsLeft = delaySecs - ((currentMillis - previousMillis) / 1000);
-    Serial.print("    count down:  ");
-    Serial.print(secondsLeft);
-    Serial.print(" sec");
-    if (secondsLeft > 1)
-      Serial.print("s");
-    return;
+  return sampleSums[zone] / FILTER_SAMPLES;
+}
+
+/* Replace the oldest sample for every zone with a new reading. */
+void takeSamples()
+{
+  int zone;
+  int voltage;
+
+  for (zone = 0; zone < NUM_ZONES; zone++) {
+    voltage = analogRead(analogInPins[zone]);
+    sampleSums[zone] += voltage - samples[zone][nextSample];
+    samples[zone][nextSample] = voltage;
+  }
+  nextSample = (nextSample + 1) % FILTER_SAMPLES;
+  if (samplesTaken < FILTER_SAMPLES)
+    samplesTaken++;
+}
+
+void updateLed()
+{
+  int zone;
+
+  for (zone = 0; zone < NUM_ZONES; zone++) {
+    if (pumpOn[zone]) {
+      digitalWrite(ledPin, HIGH);
+      return;
+    }
   }
-  
-  digitalWrite(ledPin, HIGH);
-  digitalWrite(pumpVccPin, HIGH);
-  
-  delay(wateringMicrosecs);
-  
-  digitalWrite(pumpVccPin, LOW);
   digitalWrite(ledPin, LOW);
-  previousMillis = currentMillis;
+}
+
+/* Seconds until we're willing to water this zone again */
+unsigned long secondsLeft(int zone, unsigned long currentMillis)
+{
+  unsigned long secondsSince;
+
+  secondsSince = (currentMillis - previousMillis[zone]) / 1000;
+  if (secondsSince > delaySecs)
+    return 0;
+  return delaySecs - secondsSince;
+}
+
+/* Turn on the pump; checkPump() turns it off wateringMillis later.
+ * Refuse to water more often than delaySecs.
+ */
+void waterPlant(int zone, unsigned long currentMillis)
+{
+  if (pumpOn[zone] ||
+      (currentMillis - previousMillis[zone]) / 1000 <= delaySecs)
+    return;
+
+  digitalWrite(pumpVccPins[zone], HIGH);
+  pumpOn[zone] = true;
+  pumpStartMillis[zone] = currentMillis;
+  previousMillis[zone] = currentMillis;
+  updateLed();
+}
+
+void checkPump(int zone, unsigned long currentMillis)
+{
+  if (!pumpOn[zone] ||
+      currentMillis - pumpStartMillis[zone] < wateringMillis)
+    return;
+
+  digitalWrite(pumpVccPins[zone], LOW);
+  pumpOn[zone] = false;
+  updateLed();
+}
+
+void sendTelemetry(int zone, unsigned long currentMillis)
+{
+  byte frame[FRAME_LENGTH];
+  unsigned int voltage = filteredVoltage(zone);
+  unsigned int countdown = secondsLeft(zone, currentMillis);
+  byte check = 0;
+  int i;
+
+  frame[0] = FRAME_START;
+  frame[1] = zone;
+  frame[2] = pumpOn[zone] ? FRAME_PUMP_ON : 0;
+  frame[3] = voltage & 0xff;
+  frame[4] = voltage >> 8;
+  frame[5] = countdown & 0xff;
+  frame[6] = countdown >> 8;
+  for (i = 1; i < FRAME_LENGTH - 1; i++)
+    check ^= frame[i];
+  frame[FRAME_LENGTH - 1] = check;
+  Serial.write(frame, FRAME_LENGTH);
 }
 
 void loop()
 {
-  /* 0 to 1023, representing 0 to 5V */
-  int voltage;
-  
-  voltage = analogRead(analogInPin);
-  Serial.print(voltage);
-  if (voltage < voltageThreshold)
-    waterPlant();
-  Serial.println("");
-  delay(100);
+  unsigned long currentMillis;
+  int zone;
+
+  currentMillis = millis();
+
+  for (zone = 0; zone < NUM_ZONES; zone++)
+    checkPump(zone, currentMillis);
+
+  if (currentMillis - lastSampleMillis >= sampleMillis) {
+    lastSampleMillis = currentMillis;
+    takeSamples();
+    /* Wait for a full filter's worth of samples before trusting it */
+    for (zone = 0; zone < NUM_ZONES && samplesTaken == FILTER_SAMPLES;
+        zone++) {
+      if (filteredVoltage(zone) < voltageThresholds[zone])
+        waterPlant(zone, currentMillis);
+    }
+  }
+
+  if (currentMillis - lastTelemetryMillis >= telemetryMillis) {
+    lastTelemetryMillis = currentMillis;
+    for (zone = 0; zone < NUM_ZONES; zone++)
+      sendTelemetry(zone, currentMillis);
+  }
 }
@@ -0,0 +1,49 @@
+/*
+ * Mock Arduino HAL for building sketches on Linux
+ * Copyright (C) 2010 Sarah Sharp
+ *
+ * Just enough of the Arduino core for the garduino sketches.  Time only
+ * moves when the replay harness (or the sketch, through delay() or by
+ * writing to the serial port) moves it, and the pins talk to the harness's
+ * simulated sensors and pumps.
+ */
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW	0
+#define HIGH	1
+#define INPUT	0
+#define OUTPUT	1
+
+#define NUM_DIGITAL_PINS	20
+#define NUM_ANALOG_PINS		6
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+unsigned long millis(void);
+void delay(unsigned long ms);
+
+class MockSerial {
+public:
+	void begin(long baud);
+	size_t write(byte value);
+	size_t write(const byte *buf, size_t len);
+	size_t print(const char *string);
+	size_t print(long value);
+	size_t println(const char *string);
+	size_t println(long value);
+
+	long		baud;
+	unsigned long	bytes_written;
+};
+
+extern MockSerial Serial;
+
+#endif /* MOCK_ARDUINO_H */
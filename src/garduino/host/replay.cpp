@@ -0,0 +1,488 @@
+/*
+ * Replay harness for the garduino sketch
+ * Copyright (C) 2010 Sarah Sharp
+ *
+ * Build blinky_read.pde against the mock Arduino HAL and run it on a
+ * simulated clock, feeding its sensors either a recorded moisture trace or
+ * a simple scripted plant that dries out and gets wet when the pump runs.
+ * Afterwards, print how the watering logic did:
+ *
+ *  - pump duty cycle (how much of the time each pump was on)
+ *  - reaction latency, from the first reading the sketch got below the
+ *    threshold until the pump turned on
+ *  - lockout waits, between waterings while a zone stays dry, which are
+ *    the sketch's delaySecs rather than how fast it reacts
+ *  - missed samples, compared to reading every sensor every sampleMillis
+ *
+ * Readings are rounded to whole ADC counts, and the scripted plant adds
+ * sensor noise, so latency is measured from what analogRead() actually
+ * returned rather than from the simulated plant's exact moisture.
+ *
+ * loop() is called once per tick of the simulated clock, which defaults to
+ * sampleMillis.  Longer ticks replay faster, but shorter ones show how the
+ * sketch would really have timed things.  Serial writes block for as long
+ * as the bytes take to go out at the sketch's baud rate, the way they did
+ * on the board, so a loop() that sends telemetry can miss samples.
+ *
+ * Usage: blinky-replay [-d days] [-t tick ms] [-o telemetry file] [trace file]
+ *
+ * Trace files have one line per reading, with the time in seconds and then
+ * one reading (0 to 1023) per zone:
+ *	#seconds,zone 0 reading,zone 1 reading...
+ *	0,880
+ *	3600,840
+ * Readings are interpolated in between lines.
+ *
+ * Try other thresholds without touching the sketch:
+ *	make replay VOLTAGE_THRESHOLD=700 DELAY_SECS=60
+ */
+#define _XOPEN_SOURCE 500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "Arduino.h"
+
+#include "../blinky_read/blinky_read.pde"
+
+/* The scripted plant, when there's no trace */
+#define SCRIPT_START_READING	900.0
+#define SCRIPT_DRY_PER_HOUR	40.0
+#define SCRIPT_WET_PER_SECOND	200.0
+#define SCRIPT_NOISE		4
+
+#define MAX_TRACE_LINE		500
+
+struct trace_point {
+	unsigned long	millis;
+	float		readings[NUM_ZONES];
+};
+
+struct trace {
+	struct trace_point	*points;
+	unsigned int		num_points;
+	unsigned int		cursor;
+};
+
+/* What the harness knows about each zone, and what it has measured */
+struct zone_stats {
+	double		reading;	/* the sensor's true value right now */
+	boolean		below;		/* read below the threshold yet? */
+	unsigned long	crossed_millis;	/* when it was first read below */
+	boolean		waiting;	/* has the pump answered that yet? */
+	unsigned long	pump_on_millis;
+	unsigned long	pump_on_total;
+	unsigned int	waterings;
+	unsigned int	early;		/* waterings before any reading dropped */
+	unsigned int	rewaterings;	/* waterings while it was still dry */
+	unsigned long	lockout_total;
+	unsigned long	lockout_max;
+	unsigned int	crossings;
+	unsigned int	answered;
+	unsigned long	latency_total;
+	unsigned long	latency_max;
+	unsigned long	samples;
+};
+
+static unsigned long sim_millis;
+static unsigned long world_millis;
+static int pin_values[NUM_DIGITAL_PINS];
+static struct zone_stats zones[NUM_ZONES];
+static struct trace *world_trace;
+static unsigned int noise_seed = 1;
+static FILE *telemetry_fp;
+static unsigned long serial_micros;	/* owed to the clock, under 1 ms */
+
+MockSerial Serial;
+
+/****************** Simulated world ******************/
+
+static int zone_for_pump(int pin)
+{
+	int zone;
+
+	for (zone = 0; zone < NUM_ZONES; zone++)
+		if (pumpVccPins[zone] == pin)
+			return zone;
+	return -1;
+}
+
+static int zone_for_sensor(int pin)
+{
+	int zone;
+
+	for (zone = 0; zone < NUM_ZONES; zone++)
+		if (analogInPins[zone] == pin)
+			return zone;
+	return -1;
+}
+
+static double trace_reading(struct trace *trace, int zone, unsigned long now)
+{
+	struct trace_point *a, *b;
+
+	while (trace->cursor + 1 < trace->num_points &&
+			trace->points[trace->cursor + 1].millis <= now)
+		trace->cursor++;
+	a = &trace->points[trace->cursor];
+	if (trace->cursor + 1 == trace->num_points || now <= a->millis)
+		return a->readings[zone];
+	b = a + 1;
+	return a->readings[zone] + (b->readings[zone] - a->readings[zone]) *
+		(double) (now - a->millis) / (b->millis - a->millis);
+}
+
+/* Move the world forward to now in one step */
+static void advance_world(unsigned long now)
+{
+	struct zone_stats *stats;
+	unsigned long dt = now - world_millis;
+	int zone;
+
+	if (!dt)
+		return;
+	for (zone = 0; zone < NUM_ZONES; zone++) {
+		stats = &zones[zone];
+		if (world_trace) {
+			stats->reading = trace_reading(world_trace, zone, now);
+		} else {
+			stats->reading -= SCRIPT_DRY_PER_HOUR * dt /
+				(60 * 60 * 1000);
+			if (pin_values[pumpVccPins[zone]])
+				stats->reading +=
+					SCRIPT_WET_PER_SECOND * dt / 1000;
+			if (stats->reading > 1023)
+				stats->reading = 1023;
+		}
+	}
+	world_millis = now;
+	sim_millis = now;
+}
+
+/****************** Mock Arduino HAL ******************/
+
+void pinMode(int pin, int mode)
+{
+}
+
+void digitalWrite(int pin, int value)
+{
+	struct zone_stats *stats;
+	unsigned long latency;
+	unsigned long lockout;
+	int zone;
+
+	zone = zone_for_pump(pin);
+	if (zone >= 0 && value != pin_values[pin]) {
+		stats = &zones[zone];
+		if (value) {
+			if (stats->waiting) {
+				latency = sim_millis - stats->crossed_millis;
+				stats->latency_total += latency;
+				if (latency > stats->latency_max)
+					stats->latency_max = latency;
+				stats->answered++;
+				stats->waiting = false;
+			} else if (stats->below && stats->waterings) {
+				/* Still dry since the last watering */
+				lockout = sim_millis - stats->pump_on_millis;
+				stats->lockout_total += lockout;
+				if (lockout > stats->lockout_max)
+					stats->lockout_max = lockout;
+				stats->rewaterings++;
+			} else {
+				stats->early++;
+			}
+			stats->pump_on_millis = sim_millis;
+			stats->waterings++;
+		} else {
+			stats->pump_on_total +=
+				sim_millis - stats->pump_on_millis;
+		}
+	}
+	pin_values[pin] = value;
+}
+
+/*
+ * Note when the sketch first reads a zone below its threshold.  With
+ * noise, readings near the threshold bounce above and below it, so the
+ * zone only counts as wet again once a reading is too high for noise to
+ * explain.  Running the pump doesn't count: a recorded trace can't get
+ * wetter however often the sketch waters it.
+ */
+static void check_reading(struct zone_stats *stats, int zone, int reading)
+{
+	int noise = world_trace ? 0 : SCRIPT_NOISE;
+
+	if (reading < voltageThresholds[zone] && !stats->below) {
+		stats->below = true;
+		stats->crossings++;
+		stats->crossed_millis = sim_millis;
+		stats->waiting = true;
+	} else if (reading >= voltageThresholds[zone] + 2*noise) {
+		stats->below = false;
+		stats->waiting = false;
+	}
+}
+
+int analogRead(int pin)
+{
+	int zone = zone_for_sensor(pin);
+	int reading;
+
+	if (zone < 0)
+		return 0;
+	zones[zone].samples++;
+	reading = lround(zones[zone].reading);
+	if (!world_trace) {
+		noise_seed = noise_seed * 1103515245 + 12345;
+		reading += (int) ((noise_seed >> 16) % (2*SCRIPT_NOISE + 1)) -
+			SCRIPT_NOISE;
+	}
+	if (reading < 0)
+		reading = 0;
+	if (reading > 1023)
+		reading = 1023;
+	check_reading(&zones[zone], zone, reading);
+	return reading;
+}
+
+unsigned long millis(void)
+{
+	return sim_millis;
+}
+
+void delay(unsigned long ms)
+{
+	advance_world(sim_millis + ms);
+}
+
+void MockSerial::begin(long new_baud)
+{
+	baud = new_baud;
+}
+
+/* Each byte is 10 bits on the wire, with its start and stop bits */
+size_t MockSerial::write(const byte *buf, size_t len)
+{
+	bytes_written += len;
+	if (telemetry_fp)
+		fwrite(buf, 1, len, telemetry_fp);
+	if (baud) {
+		serial_micros += len * 10 * 1000000UL / baud;
+		advance_world(sim_millis + serial_micros / 1000);
+		serial_micros %= 1000;
+	}
+	return len;
+}
+
+size_t MockSerial::write(byte value)
+{
+	return write(&value, 1);
+}
+
+size_t MockSerial::print(const char *string)
+{
+	return write((const byte *) string, strlen(string));
+}
+
+size_t MockSerial::print(long value)
+{
+	char string[32];
+
+	snprintf(string, sizeof(string), "%ld", value);
+	return print(string);
+}
+
+size_t MockSerial::println(const char *string)
+{
+	return print(string) + print("\r\n");
+}
+
+size_t MockSerial::println(long value)
+{
+	return print(value) + print("\r\n");
+}
+
+/****************** Traces ******************/
+
+static struct trace *load_trace(char *filename)
+{
+	FILE *fp;
+	struct trace *trace;
+	struct trace_point *tmp;
+	char line[MAX_TRACE_LINE];
+	char *field;
+	unsigned int list_size = 0;
+	float seconds;
+	int zone;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		printf("Bad trace file.\n");
+		return NULL;
+	}
+	trace = (struct trace *) calloc(1, sizeof(*trace));
+	if (!trace) {
+		fclose(fp);
+		return NULL;
+	}
+
+	while (fgets(line, MAX_TRACE_LINE, fp)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (trace->num_points == list_size) {
+			list_size = list_size ? list_size*2 : 1024;
+			tmp = (struct trace_point *) realloc(trace->points,
+					sizeof(*tmp)*list_size);
+			if (!tmp) {
+				printf("Out of memory\n");
+				fclose(fp);
+				return NULL;
+			}
+			trace->points = tmp;
+		}
+		field = strtok(line, ",");
+		if (!field || sscanf(field, "%f", &seconds) != 1)
+			continue;
+		trace->points[trace->num_points].millis = seconds * 1000;
+		for (zone = 0; zone < NUM_ZONES; zone++) {
+			field = strtok(NULL, ",");
+			/* Zones missing from the trace stay wet */
+			trace->points[trace->num_points].readings[zone] =
+				field ? atof(field) : 1023;
+		}
+		trace->num_points++;
+	}
+	fclose(fp);
+	if (!trace->num_points) {
+		printf("No readings in %s\n", filename);
+		return NULL;
+	}
+	return trace;
+}
+
+/****************** Results ******************/
+
+static void print_results(unsigned long end, unsigned long tick,
+		double elapsed_ms)
+{
+	struct zone_stats *stats;
+	unsigned long expected;
+	int zone;
+
+	printf("Simulated %.2f days (%lu ms) in %.0f ms\n",
+			end / (24.0 * 60 * 60 * 1000), end, elapsed_ms);
+	for (zone = 0; zone < NUM_ZONES; zone++) {
+		stats = &zones[zone];
+		if (pin_values[pumpVccPins[zone]])
+			stats->pump_on_total += end - stats->pump_on_millis;
+		printf("zone %i: watered %u time%s, pump duty cycle %.3f%%\n",
+				zone, stats->waterings,
+				stats->waterings == 1 ? "" : "s",
+				100.0 * stats->pump_on_total / end);
+		printf("zone %i: dropped below %i %u time%s, ",
+				zone, voltageThresholds[zone], stats->crossings,
+				stats->crossings == 1 ? "" : "s");
+		if (stats->answered)
+			printf("pump reacted %u time%s in %.1f ms on average, "
+					"%lu ms at worst\n",
+					stats->answered,
+					stats->answered == 1 ? "" : "s",
+					(double) stats->latency_total /
+					stats->answered,
+					stats->latency_max);
+		else
+			printf("pump never reacted\n");
+		if (stats->rewaterings)
+			printf("zone %i: watered %u more time%s while still "
+					"dry, %.1f ms apart on average, "
+					"%lu ms at worst (lockout)\n",
+					zone, stats->rewaterings,
+					stats->rewaterings == 1 ? "" : "s",
+					(double) stats->lockout_total /
+					stats->rewaterings,
+					stats->lockout_max);
+		if (stats->early)
+			printf("zone %i: watered %u time%s before any reading "
+					"dropped below %i\n",
+					zone, stats->early,
+					stats->early == 1 ? "" : "s",
+					voltageThresholds[zone]);
+		/* The sketch can't sample more often than loop() runs */
+		expected = end / (tick > sampleMillis ? tick : sampleMillis);
+		printf("zone %i: %lu samples, %lu missed\n", zone,
+				stats->samples, expected > stats->samples ?
+				expected - stats->samples : 0);
+	}
+	printf("serial: %lu bytes, %.1f bytes/sec (%ld baud allows %ld)\n",
+			Serial.bytes_written,
+			Serial.bytes_written * 1000.0 / end,
+			Serial.baud, Serial.baud / 10);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec start, stop;
+	unsigned long end = 0;
+	unsigned long tick = sampleMillis;
+	float days = 0;
+	int opt;
+	int zone;
+
+	while ((opt = getopt(argc, argv, "d:t:o:")) != -1) {
+		switch (opt) {
+		case 'd':
+			days = atof(optarg);
+			break;
+		case 't':
+			tick = strtoul(optarg, NULL, 10);
+			if (!tick)
+				tick = 1;
+			break;
+		case 'o':
+			telemetry_fp = fopen(optarg, "w");
+			if (!telemetry_fp) {
+				printf("Bad telemetry file.\n");
+				return -1;
+			}
+			break;
+		default:
+			printf("Help: blinky-replay [-d days] [-t tick ms] "
+					"[-o telemetry file] [trace file]\n");
+			return -1;
+		}
+	}
+
+	if (optind < argc) {
+		world_trace = load_trace(argv[optind]);
+		if (!world_trace)
+			return -1;
+		end = world_trace->points[world_trace->num_points - 1].millis;
+	}
+	if (days > 0)
+		end = days * 24 * 60 * 60 * 1000;
+	if (!end)
+		end = 24 * 60 * 60 * 1000;
+
+	for (zone = 0; zone < NUM_ZONES; zone++)
+		zones[zone].reading = world_trace ?
+			trace_reading(world_trace, zone, 0) :
+			SCRIPT_START_READING;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	setup();
+	while (sim_millis < end) {
+		advance_world(sim_millis + tick);
+		loop();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	if (telemetry_fp)
+		fclose(telemetry_fp);
+	print_results(sim_millis, tick, (stop.tv_sec - start.tv_sec) * 1000.0 +
+			(stop.tv_nsec - start.tv_nsec) / 1000000.0);
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "gardengeek.h"
+
+/****************** Plant growth simulation functions ******************/
+
+/*
+ * The simple growth model from docs/goals.txt: every plant doubles in size at
+ * the same constant rate outdoors, and at a slower constant rate under the
+ * grow lamp.  Plants would rather grow up than out past their spacing, so
+ * the spacing caps how much ground each plant covers.
+ */
+#define SEEDLING_SQUARE_FEET		0.01
+#define GROW_LAMP_DOUBLING_DAYS		15
+#define OUTDOOR_DOUBLING_DAYS		10
+
+/*
+ * Each plant's parameters and state in separate arrays, so the daily step
+ * is a simple loop over flat arrays that the compiler can vectorize.
+ */
+struct growth_simulation {
+	unsigned int	num_plants;
+	int		first_day;
+	int		last_day;
+	int		*sprout_day;
+	int		*transplant_day;
+	int		*end_day;
+	float		*num_plants_growing;
+	float		*max_square_feet;
+	float		*square_feet;	/* per plant, today */
+	float		*area;		/* all of a row's plants, today */
+};
+
+static void free_growth_simulation(struct growth_simulation *sim)
+{
+	free(sim->sprout_day);
+	free(sim->transplant_day);
+	free(sim->end_day);
+	free(sim->num_plants_growing);
+	free(sim->max_square_feet);
+	free(sim->square_feet);
+	free(sim->area);
+}
+
+static int setup_growth_simulation(struct growth_simulation *sim,
+		struct plant **plants, unsigned int num_plants)
+{
+	unsigned int i, n = num_plants + 1;
+	int day;
+
+	memset(sim, 0, sizeof(*sim));
+	sim->num_plants = num_plants;
+	sim->sprout_day = malloc(sizeof(int)*n);
+	sim->transplant_day = malloc(sizeof(int)*n);
+	sim->end_day = malloc(sizeof(int)*n);
+	sim->num_plants_growing = malloc(sizeof(float)*n);
+	sim->max_square_feet = malloc(sizeof(float)*n);
+	sim->square_feet = malloc(sizeof(float)*n);
+	sim->area = malloc(sizeof(float)*n);
+	if (!sim->sprout_day || !sim->transplant_day || !sim->end_day ||
+			!sim->num_plants_growing || !sim->max_square_feet ||
+			!sim->square_feet || !sim->area) {
+		free_growth_simulation(sim);
+		return 0;
+	}
+
+	sim->first_day = INT_MAX;
+	sim->last_day = INT_MIN;
+	for (i = 0; i < num_plants; i++) {
+		sim->sprout_day[i] =
+			date_to_day_number(&plants[i]->sprouting_date);
+		sim->transplant_day[i] = get_outdoor_start_day(plants[i]);
+		sim->end_day[i] = get_outdoor_end_day(plants[i]);
+		sim->num_plants_growing[i] =
+			plants[i]->num_plants_to_harvest;
+		sim->max_square_feet[i] = plants[i]->square_feet_per_plant;
+		if (sim->max_square_feet[i] <= 0)
+			sim->max_square_feet[i] = 1;
+		sim->square_feet[i] = SEEDLING_SQUARE_FEET;
+
+		day = date_to_day_number(&plants[i]->seeding_date);
+		if (day < sim->first_day)
+			sim->first_day = day;
+		/* The season is over after the last harvest */
+		day = date_to_day_number(&plants[i]->harvest_date);
+		if (day > sim->last_day)
+			sim->last_day = day;
+	}
+	return 1;
+}
+
+/*
+ * Grow every plant by one day.  Plants that haven't sprouted stay seedling
+ * sized, and plants that have been harvested take up no room.  Returns the
+ * area in use indoors and outdoors.
+ */
+static void step_growth_simulation(struct growth_simulation *sim, int day,
+		float lamp_rate, float outdoor_rate,
+		float *indoor_area, float *outdoor_area)
+{
+	unsigned int i;
+	float rate, grown, area;
+	float indoor = 0;
+	float outdoor = 0;
+
+	for (i = 0; i < sim->num_plants; i++) {
+		rate = day < sim->transplant_day[i] ? lamp_rate : outdoor_rate;
+		grown = sim->square_feet[i] * rate;
+		grown = grown < sim->max_square_feet[i] ?
+			grown : sim->max_square_feet[i];
+		sim->square_feet[i] = day < sim->sprout_day[i] ?
+			SEEDLING_SQUARE_FEET : grown;
+		area = (day >= sim->sprout_day[i] && day < sim->end_day[i]) ?
+			sim->square_feet[i] * sim->num_plants_growing[i] : 0;
+		sim->area[i] = area;
+		indoor += day < sim->transplant_day[i] ? area : 0;
+		outdoor += day < sim->transplant_day[i] ? 0 : area;
+	}
+	*indoor_area = indoor;
+	*outdoor_area = outdoor;
+}
+
+/*
+ * Print one CSV line per day of the season: the date, the square feet in
+ * use under the grow lamp and in the garden, and then each plant row's
+ * square feet.
+ */
+int print_growth_simulation(FILE *out, struct plant **plants,
+		unsigned int num_plants)
+{
+	struct growth_simulation sim;
+	struct tm date;
+	char string[MAX_NAME_LENGTH];
+	float lamp_rate = pow(2, 1.0 / GROW_LAMP_DOUBLING_DAYS);
+	float outdoor_rate = pow(2, 1.0 / OUTDOOR_DOUBLING_DAYS);
+	float indoor_area, outdoor_area;
+	unsigned int i;
+	int day;
+
+	if (!num_plants)
+		return 1;
+	if (!setup_growth_simulation(&sim, plants, num_plants))
+		return 0;
+
+	fprintf(out, "date,indoor plot,outdoor plot");
+	for (i = 0; i < num_plants; i++)
+		fprintf(out, ",%s", plants[i]->name);
+	fprintf(out, "\n");
+
+	for (day = sim.first_day; day <= sim.last_day; day++) {
+		step_growth_simulation(&sim, day, lamp_rate, outdoor_rate,
+				&indoor_area, &outdoor_area);
+		day_number_to_date(day, &date);
+		strftime(string, MAX_NAME_LENGTH, "%Y-%m-%d", &date);
+		fprintf(out, "%s,%.2f,%.2f", string, indoor_area, outdoor_area);
+		for (i = 0; i < num_plants; i++) {
+			if (sim.area[i] == 0)
+				fprintf(out, ",0");
+			else
+				fprintf(out, ",%.2f", sim.area[i]);
+		}
+		fprintf(out, "\n");
+	}
+	free_growth_simulation(&sim);
+	return 1;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "gardengeek.h"
+
+/****************** Name table functions ******************/
+
+/*
+ * Open addressing with linear probing, never more than half full, so a
+ * lookup is one hash and usually one string compare.  Each kind of entry
+ * starts with a struct name_entry, and the rest of it is zeroed when it's
+ * added.  Adding can move every entry, so pointers to entries are only
+ * good until the next add.
+ */
+#define NAME_TABLE_SLOTS	1024	/* to start with; a power of two */
+
+void init_name_table(struct name_table *table, size_t entry_size)
+{
+	memset(table, 0, sizeof(*table));
+	table->entry_size = entry_size;
+}
+
+void free_name_table(struct name_table *table)
+{
+	unsigned int i;
+
+	for (i = 0; i < table->num_slots; i++)
+		free(get_name_table_slot(table, i)->name);
+	free(table->entries);
+	table->entries = NULL;
+	table->num_slots = 0;
+	table->num_entries = 0;
+}
+
+/* The entry in a slot, which has a NULL name if the slot is empty */
+struct name_entry *get_name_table_slot(struct name_table *table,
+		unsigned int slot)
+{
+	return (struct name_entry *) (table->entries +
+			(size_t) slot * table->entry_size);
+}
+
+static uint64_t hash_name_entry(const char *name, size_t len, int number)
+{
+	return hash_name(name, len) ^
+		((uint64_t) (unsigned int) number * 0x9e3779b97f4a7c15ULL);
+}
+
+/* The entry with this name and number, or the empty slot it would go in */
+static struct name_entry *probe_name_table(struct name_table *table,
+		const char *name, size_t len, int number, uint64_t hash)
+{
+	struct name_entry *entry;
+	unsigned int slot;
+
+	slot = hash & (table->num_slots - 1);
+	for (;; slot = (slot + 1) & (table->num_slots - 1)) {
+		entry = get_name_table_slot(table, slot);
+		if (!entry->name)
+			return entry;
+		if (entry->hash == hash && entry->number == number &&
+				!strncmp(entry->name, name, len) &&
+				entry->name[len] == '\0')
+			return entry;
+	}
+}
+
+static int grow_name_table(struct name_table *table)
+{
+	char *old_entries = table->entries;
+	unsigned int old_slots = table->num_slots;
+	struct name_entry *entry;
+	unsigned int i, slot;
+
+	table->num_slots = old_slots ? old_slots*2 : NAME_TABLE_SLOTS;
+	table->entries = calloc(table->num_slots, table->entry_size);
+	if (!table->entries) {
+		table->entries = old_entries;
+		table->num_slots = old_slots;
+		return 0;
+	}
+	for (i = 0; i < old_slots; i++) {
+		entry = (struct name_entry *) (old_entries +
+				(size_t) i * table->entry_size);
+		if (!entry->name)
+			continue;
+		slot = entry->hash & (table->num_slots - 1);
+		while (get_name_table_slot(table, slot)->name)
+			slot = (slot + 1) & (table->num_slots - 1);
+		memcpy(get_name_table_slot(table, slot), entry,
+				table->entry_size);
+	}
+	free(old_entries);
+	return 1;
+}
+
+/* Look up the first len characters of name, with a number.  NULL if
+ * there's no such entry.
+ */
+struct name_entry *find_name_entry(struct name_table *table,
+		const char *name, size_t len, int number)
+{
+	struct name_entry *entry;
+
+	if (!table->num_slots)
+		return NULL;
+	entry = probe_name_table(table, name, len, number,
+			hash_name_entry(name, len, number));
+	return entry->name ? entry : NULL;
+}
+
+/* Look up an entry, and add it if it isn't there.  NULL if out of memory. */
+struct name_entry *add_name_entry(struct name_table *table,
+		const char *name, size_t len, int number)
+{
+	uint64_t hash = hash_name_entry(name, len, number);
+	struct name_entry *entry;
+
+	if (2*(table->num_entries + 1) > table->num_slots &&
+			!grow_name_table(table))
+		return NULL;
+	entry = probe_name_table(table, name, len, number, hash);
+	if (entry->name)
+		return entry;
+
+	entry->name = malloc(len + 1);
+	if (!entry->name)
+		return NULL;
+	memcpy(entry->name, name, len);
+	entry->name[len] = '\0';
+	entry->hash = hash;
+	entry->number = number;
+	table->num_entries++;
+	return entry;
+}
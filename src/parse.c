@@ -0,0 +1,223 @@
+#define _XOPEN_SOURCE 500 /* glibc2 needs this */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include "gardengeek.h"
+
+int skip_comment_lines(FILE *fp)
+{
+	int tmp, tmp2;
+
+	/* Skip lines that start with # */
+	do {
+		tmp = fgetc(fp);
+		if (tmp == EOF)
+			return 0;
+
+		/* Put the last character peeked at back */
+		tmp2 = ungetc(tmp, fp);
+		if (tmp2 == EOF)
+			return 0;
+
+		if (tmp != '#')
+			break;
+		/* Eat up to the newline, however long the comment is */
+		tmp2 = fscanf(fp, "%*[^\n]");
+		if (tmp2 == EOF)
+			return 0;
+		/* Eat the newline */
+		tmp = fgetc(fp);
+	} while (1);
+	return 1;
+}
+
+/*
+ * Copy the next comma-separated word.  Words longer than MAX_NAME_LENGTH
+ * are cut short, and the rest of them skipped.
+ */
+int copy_word_from_file(FILE *fp, char **new_word)
+{
+	char word[MAX_NAME_LENGTH];
+
+	word[0] = '\0';
+	fscanf(fp, "%" MAX_NAME_FIELD "[^,]", word);
+	fscanf(fp, "%*[^,]");
+	*new_word = malloc(strlen(word) + 1);
+	if (!*new_word)
+		return 0;
+	strcpy(*new_word, word);
+	fgetc(fp);
+	return 1;
+}
+
+
+char *copy_string(char *string)
+{
+	char *copy = malloc(strlen(string) + 1);
+
+	if (copy)
+		strcpy(copy, string);
+	return copy;
+}
+
+static int parse_planting_date(char *word, struct plant *new_plant)
+{
+	if (word[0] == '+' || word[0] == '-') {
+		if (sscanf(word, "%d", &new_plant->days_after_last_frost) != 1)
+			return 0;
+		new_plant->relative_to_last_frost = 1;
+		day_number_to_date(REFERENCE_LAST_FROST +
+				new_plant->days_after_last_frost,
+				&new_plant->outdoor_planting_date);
+		return 1;
+	}
+	return strptime(word, "%Y-%m-%d",
+			&new_plant->outdoor_planting_date) != NULL;
+}
+
+/*
+ * Read the next plant row.  At the end of the file, this returns NULL with
+ * the error set to GARDEN_OK.
+ */
+struct plant *parse_and_create_plant(FILE *fp, struct variety_catalog *catalog,
+		struct garden_error *error)
+{
+	struct plant *new_plant;
+	struct variety *variety;
+	char *string;
+	char word[MAX_NAME_LENGTH];
+	int separator;
+
+	new_plant = malloc(sizeof(*new_plant));
+	if (!new_plant) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return NULL;
+	}
+	memset(new_plant, 0, sizeof(*new_plant));
+
+	if(!skip_comment_lines(fp)) {
+		set_garden_error(error, GARDEN_OK, NULL);
+		goto fail;
+	}
+
+	/* Get the plant name */
+	if (!copy_word_from_file(fp, &new_plant->name)) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		goto fail;
+	}
+
+	/* Get the number plants we want to harvest */
+	fscanf(fp, "%u", &new_plant->num_plants_to_harvest);
+	fgetc(fp);
+
+	/* A short row ("name,number plants wanted,date") has the date where
+	 * the number of weeks indoors would be, and gets the rest of the
+	 * fields from the variety catalog.  Dates have a '-' in them, and
+	 * dates relative to the last frost start with a '+' or '-'.
+	 */
+	word[0] = '\0';
+	fscanf(fp, "%" MAX_NAME_FIELD "[^,\n]", word);
+	fscanf(fp, "%*[^,\n]");
+	separator = fgetc(fp);
+	if (strpbrk(word, "+-")) {
+		variety = find_variety_for_plant(catalog, new_plant->name);
+		if (!variety) {
+			set_garden_error(error, GARDEN_UNKNOWN_VARIETY,
+					new_plant->name);
+			goto fail;
+		}
+		inherit_variety(new_plant, variety);
+		if (!parse_planting_date(word, new_plant)) {
+			set_garden_error(error, GARDEN_BAD_DATE,
+					new_plant->name);
+			goto fail;
+		}
+		if (separator == ',')
+			read_optional_spacing(fp,
+					&new_plant->square_feet_per_plant);
+		goto sprouting;
+	}
+
+	/* Get the number of weeks indoors */
+	sscanf(word, "%u", &new_plant->num_weeks_indoors);
+
+	/* Get the number of weeks after sprouting
+	 * that we need to separate the plants.
+	 */
+	fscanf(fp, "%u", &new_plant->num_weeks_until_indoor_separation);
+	fgetc(fp);
+
+	/* Convert the outdoor planting date into something we can understand */
+	if (!copy_word_from_file(fp, &string)) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		goto fail;
+	}
+	if (!parse_planting_date(string, new_plant)) {
+		free(string);
+		set_garden_error(error, GARDEN_BAD_DATE, new_plant->name);
+		goto fail;
+	}
+	free(string);
+	
+	fscanf(fp, "%u", &new_plant->num_weeks_until_outdoor_separation);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_plant->days_to_harvest);
+	fgetc(fp);
+
+	fscanf(fp, "%f", &new_plant->germination_rate);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_plant->min_days_to_sprout);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_plant->max_days_to_sprout);
+	fgetc(fp);
+
+	fscanf(fp, "%u", &new_plant->harvest_removes_plant);
+	if (fgetc(fp) == ',')
+		read_optional_spacing(fp, &new_plant->square_feet_per_plant);
+
+sprouting:
+	new_plant->avg_days_to_sprout = (new_plant->min_days_to_sprout +
+			new_plant->max_days_to_sprout) / 2;
+
+	return new_plant;
+
+fail:
+	free_plant(new_plant);
+	return NULL;
+}
+
+void free_plant(struct plant *new_plant)
+{
+	free(new_plant->name);
+	free(new_plant);
+}
+
+int add_plant_to_list(struct plant_list *list, struct plant *new_plant)
+{
+	struct plant **tmp;
+
+	if (list->num_plants == list->list_size) {
+		list->list_size = list->list_size ? list->list_size*2 : 64;
+		tmp = realloc(list->plants,
+				sizeof(*list->plants)*list->list_size);
+		if (!tmp)
+			return 0;
+		list->plants = tmp;
+	}
+	list->plants[list->num_plants++] = new_plant;
+	return 1;
+}
+
+void free_plant_list(struct plant_list *list)
+{
+	unsigned int i;
+
+	for (i = 0; i < list->num_plants; i++)
+		free_plant(list->plants[i]);
+	free(list->plants);
+	memset(list, 0, sizeof(*list));
+}
@@ -1,800 +1,97 @@
-#define _XOPEN_SOURCE 500 /* glibc2 needs this */
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 #include <string.h>
-#include <math.h>
-
-struct plant {
-	/* input */
-	char		*name;
-	unsigned int	num_plants_to_harvest;
-	unsigned int	num_weeks_indoors;
-	unsigned int	num_weeks_until_indoor_separation;
-	struct tm	outdoor_planting_date;
-	unsigned int	num_weeks_until_outdoor_separation;
-	unsigned int	days_to_harvest;
-	float		germination_rate;
-	unsigned int	min_days_to_sprout;
-	float		avg_days_to_sprout;
-	unsigned int	max_days_to_sprout;
-	unsigned int	harvest_removes_plant; /* 0 = false; non-zero = true */
-	/* output */
-	/* XXX: These could be an array with an enum. */
-	struct tm	seeding_date;
-	struct tm	sprouting_date;
-	struct tm	last_chance_sprouting_date;
-	struct tm	indoor_separation_date;
-	struct tm	hardening_off_date;
-	struct tm	outdoor_separation_date;
-	struct tm	harvest_date;
-};
-
-struct plant_date {
-	struct tm	*date;
-	char		*summary;
-	char		*description;
-};
-
-struct date_list {
-	struct plant_date	*cal_entry;
-	struct date_list	*next;
-};
-
-#define MAX_NAME_LENGTH	500
-
-int skip_comment_lines(FILE *fp)
-{
-	int tmp, tmp2;
-	char string[MAX_NAME_LENGTH];
-
-	/* Skip lines that start with # */
-	do {
-		tmp = fgetc(fp);
-		if (tmp == EOF)
-			return 0;
-
-		string[0] = (char) tmp;
-		/* Put the last character peeked at back */
-		tmp2 = ungetc(tmp, fp);
-		if (tmp2 == EOF)
-			return 0;
-
-		if (string[0] != '#')
-			break;
-		/* Eat up to the newline */
-		tmp2 = fscanf(fp, "%[^\n]", string);
-		if (tmp2 == EOF)
-			return 0;
-		/* Eat the newline */
-		tmp = fgetc(fp);
-	} while (1);
-	return 1;
-}
-
-int copy_word_from_file(FILE *fp, char **new_word)
-{
-	char word[MAX_NAME_LENGTH];
-
-	fscanf(fp, "%[^,]", word);
-	*new_word = malloc(strlen(word) + 1);
-	if (!*new_word)
-		return 0;
-	strcpy(*new_word, word);
-	fgetc(fp);
-	return 1;
-}
-
-struct plant *parse_and_create_plant(FILE *fp)
-{
-	struct plant *new_plant;
-	char *string;
-
-	new_plant = malloc(sizeof(*new_plant));
-	if (!new_plant) {
-		printf("Out of memory\n");
-		return NULL;
-	}
-	memset(new_plant, 0, sizeof(*new_plant));
-
-	if(!skip_comment_lines(fp))
-		return NULL;
-
-	/* Get the plant name */
-	if (!copy_word_from_file(fp, &new_plant->name))
-		return NULL;
-
-	/* Get the number plants we want to harvest */
-	fscanf(fp, "%u", &new_plant->num_plants_to_harvest);
-	fgetc(fp);
-
-	/* Get the number of weeks indoors */
-	fscanf(fp, "%u", &new_plant->num_weeks_indoors);
-	fgetc(fp);
-
-	/* Get the number of weeks after sprouting
-	 * that we need to separate the plants.
-	 */
-	fscanf(fp, "%u", &new_plant->num_weeks_until_indoor_separation);
-	fgetc(fp);
-
-	/* Convert the outdoor planting date into something we can understand */
-	if (!copy_word_from_file(fp, &string))
-		return NULL;
-	if (!strptime(string, "%Y-%m-%d", &new_plant->outdoor_planting_date))
-		return NULL;
-	free(string);
-	
-	fscanf(fp, "%u", &new_plant->num_weeks_until_outdoor_separation);
-	fgetc(fp);
-
-	fscanf(fp, "%u", &new_plant->days_to_harvest);
-	fgetc(fp);
-
-	fscanf(fp, "%f", &new_plant->germination_rate);
-	fgetc(fp);
-
-	fscanf(fp, "%u", &new_plant->min_days_to_sprout);
-	fgetc(fp);
-
-	fscanf(fp, "%u", &new_plant->max_days_to_sprout);
-	fgetc(fp);
-
-	new_plant->avg_days_to_sprout = (new_plant->min_days_to_sprout +
-			new_plant->max_days_to_sprout) / 2;
-
-	fscanf(fp, "%u", &new_plant->harvest_removes_plant);
-	fgetc(fp);
-
-	return new_plant;
-}
-
-int add_days_to_date(struct tm *date, int days)
-{
-	date->tm_mday += days;
-	/* Normalize the date */
-	mktime(date);
-	return 0;
-}
-
-int calculate_indoor_plant_dates(struct plant *new_plant)
-{
-	int ret;
-	unsigned int temp;
-
-	/* Get date to start seeds indoors */
-	new_plant->seeding_date = new_plant->outdoor_planting_date;
-	ret = add_days_to_date(&new_plant->seeding_date,
-			-(new_plant->num_weeks_indoors)*7);
-	if (ret)
-		return ret;
-
-	/* Get date to separate indoor seedlings */
-	if (new_plant->num_weeks_until_indoor_separation) {
-		new_plant->indoor_separation_date =
-			new_plant->seeding_date;
-		temp = new_plant->num_weeks_until_indoor_separation*7;
-		ret = add_days_to_date(
-				&new_plant->indoor_separation_date,
-			       	temp);
-		if (ret)
-			return ret;
-	}
-
-	/* Get date to start hardening off plants (leaving them
-	 * outdoors during the day, bringing them inside at night)
-	 */
-	new_plant->hardening_off_date =
-		new_plant->outdoor_planting_date;
-	ret = add_days_to_date(&new_plant->hardening_off_date, -3);
-	if (ret)
-		return ret;
-
-	/* Set sprouting base date */
-	new_plant->sprouting_date = new_plant->seeding_date;
-	new_plant->last_chance_sprouting_date = new_plant->seeding_date;
-	return 0;
-}
-
-int calculate_direct_sown_plant_dates(struct plant *new_plant)
-{
-	int ret;
-	int temp;
-
-	new_plant->seeding_date = new_plant->outdoor_planting_date;
-	
-	new_plant->sprouting_date =
-		new_plant->outdoor_planting_date;
-	new_plant->last_chance_sprouting_date =
-		new_plant->outdoor_planting_date;
-	
-	if (new_plant->num_weeks_until_outdoor_separation) {
-		new_plant->outdoor_separation_date =
-			new_plant->outdoor_planting_date;
-		temp = new_plant->num_weeks_until_outdoor_separation;
-		ret = add_days_to_date(
-				&new_plant->outdoor_separation_date,
-				temp*7);
-		if (ret)
-			return ret;
-	}
-	return 0;
-}
-
-int calculate_plant_dates(struct plant *new_plant)
-{
-	int ret;
-
-	/* Some plants need to be direct sown outdoors,
-	 * rather than started under a sun lamp indoors.
-	 */
-	if (new_plant->num_weeks_indoors) {
-		ret = calculate_indoor_plant_dates(new_plant);
-	} else {
-		ret = calculate_direct_sown_plant_dates(new_plant);
-	}
-	if (ret)
-		return ret;
-
-	ret = add_days_to_date(&new_plant->sprouting_date,
-			(int) new_plant->avg_days_to_sprout);
-	if (ret)
-		return ret;
-
-	ret = add_days_to_date(&new_plant->last_chance_sprouting_date,
-			new_plant->max_days_to_sprout);
-	if (ret)
-		return ret;
-
-	/* Harvest date is calculated from the time the seed is in the soil,
-	 * either indoors or outdoors.
-	 */
-	new_plant->harvest_date = new_plant->seeding_date;
-	ret = add_days_to_date(&new_plant->harvest_date,
-			new_plant->days_to_harvest);
-	if (ret)
-		return ret;
-
-	return 0;
-}
-
-
-/****************** By plant calendar functions ******************/
+#include "gardengeek.h"
 
 /*
- * num seeds survived = num seeds planted * germination rate
- * num seeds survived / germination rate = num seeds planted
+ * The command line front end to libgardengeek: read a garden from a file,
+ * and print its calendars and plans to stdout.
  */
-float get_num_seeds_needed(struct plant *new_plant)
-{
-	return ceil(new_plant->num_plants_to_harvest /
-			new_plant->germination_rate);
-}
-
-void print_date(char *description, struct tm *date)
-{
-	char string[MAX_NAME_LENGTH];
-
-	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-			date);
-	printf("%s: %s\n", description, string);
-}
-
-void print_indoor_plant_dates(struct plant *new_plant)
-{
-	char string[MAX_NAME_LENGTH];
-	float num_seeds;
-
-	num_seeds = get_num_seeds_needed(new_plant);
-	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-			&new_plant->seeding_date);
-	printf("Start %i seed%s under grow lamp: %s\n",
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "",
-			string);
-	print_date("Expect sprouting seeds around",
-			&new_plant->sprouting_date);
-	print_date("Last chance for sprouting seeds",
-			&new_plant->last_chance_sprouting_date);
-
-	if (new_plant->num_weeks_until_indoor_separation)
-		print_date("Separate or move to a bigger indoor pot",
-				&new_plant->indoor_separation_date);
-
-	print_date("Start hardening off seedlings",
-			&new_plant->hardening_off_date);
-
-	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-			&new_plant->outdoor_planting_date);
-	num_seeds = new_plant->num_plants_to_harvest;
-	printf("Transplant %i plant%s outdoors: %s\n",
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "",
-			string);
-}
-
-void print_direct_sown_plant_dates(struct plant *new_plant)
-{
-	char string[MAX_NAME_LENGTH];
-	float num_seeds;
-
-	num_seeds = get_num_seeds_needed(new_plant);
-	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-			&new_plant->outdoor_planting_date);
-	printf("Direct sow %i seeds outdoors: %s\n",
-			(int) num_seeds, string);
-	print_date("Expect sprouting seeds around",
-			&new_plant->sprouting_date);
-	print_date("Last chance for sprouting seeds",
-			&new_plant->last_chance_sprouting_date);
-	
-	if (new_plant->num_weeks_until_outdoor_separation) {
-		strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-				&new_plant->outdoor_separation_date);
-		num_seeds = new_plant->num_plants_to_harvest;
-		printf("Thin to %i plant%s: %s\n",
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "",
-			string);
-	}
-}
-
-void print_action_dates(struct plant *new_plant)
-{
-	int chars_printed;
-	char string[MAX_NAME_LENGTH];
-
-	chars_printed = printf("Calendar for %s:\n", new_plant->name);
-	/* Don't count the newline */
-	for(; chars_printed > 1; chars_printed--)
-		putchar('=');
-	printf("\n");
-
-	if (new_plant->num_weeks_indoors)
-		print_indoor_plant_dates(new_plant);
-	else
-		print_direct_sown_plant_dates(new_plant);
-
-	strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
-			&new_plant->harvest_date);
-	if (new_plant->harvest_removes_plant)
-		printf("Harvest plants: %s\n", string);
-	else
-		printf("Start harvesting: %s\n", string);
-
-}
-
-/****************** By month calendar functions ******************/
-
-/* Is this time less than that time? */
-int date_is_less_than(struct tm *this,
-		struct tm *that)
-{
-	time_t this_time;
-	time_t that_time;
-
-	/* Turn both into epoch time */
-	this_time = mktime(this);
-	that_time = mktime(that);
-
-	return this_time < that_time;
-}
 
-int dates_are_equal(struct tm *this, struct tm *that)
+static FILE *open_input(char *filename)
 {
-	time_t this_time;
-	time_t that_time;
-
-	/* Turn both into epoch time */
-	this_time = mktime(this);
-	that_time = mktime(that);
+	FILE *fp = fopen(filename, "r");
 
-	return this_time == that_time;
+	if (!fp)
+		printf("Bad file %s.\n", filename);
+	return fp;
 }
 
-int sort_in_one_date(struct plant_date *cal_entry,
-		struct date_list **head_ptr)
+/*
+ * Read a list of garden files, one per line, and print how many seeds of
+ * each variety they need each week.
+ */
+static int make_seed_order(FILE *fp, struct variety_catalog *catalog,
+		struct sprout_stats *stats)
 {
-	struct date_list **next_ptr = NULL;
-	struct date_list *new_date;
-
-
-	new_date = malloc(sizeof(*new_date));
-	if (!new_date)
-		return 0;
-	new_date->cal_entry = cal_entry;
+	struct garden_error error;
+	char **filenames = NULL;
+	char **tmp;
+	char line[MAX_NAME_LENGTH];
+	unsigned int num_files = 0;
+	unsigned int list_size = 0;
+	unsigned long num_skipped;
+	int ret;
 
-	/* This is where C++ operator overloading would be great. */
-	for (next_ptr = head_ptr; *next_ptr != NULL;
-			next_ptr = &(*next_ptr)->next) {
-		/* If the new date is less than the next item in the list,
-		 * insert it before that item in the list.
-		 */
-		if (date_is_less_than(cal_entry->date,
-					(*next_ptr)->cal_entry->date)) {
-			new_date->next = *next_ptr;
-			*next_ptr = new_date;
-			return 1;
+	while (fgets(line, sizeof(line), fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (!line[0] || line[0] == '#')
+			continue;
+		if (num_files == list_size) {
+			list_size = list_size ? list_size*2 : 64;
+			tmp = realloc(filenames, sizeof(*filenames)*list_size);
+			if (!tmp) {
+				printf("Out of memory\n");
+				return 0;
+			}
+			filenames = tmp;
 		}
-	}
-	new_date->next = NULL;
-	*next_ptr = new_date;
-	return 1;
-}
-
-struct plant_date *make_calendar_entry(struct tm *date,
-		char *summary, char *description)
-{
-	struct plant_date *cal_entry;
-
-	cal_entry = malloc(sizeof(*cal_entry));
-	if (!cal_entry)
-		return NULL;
-
-	cal_entry->date = date;
-	cal_entry->summary = summary;
-	cal_entry->description = description;
-	return cal_entry;
-}
-
-int insert_calendar_entry(struct tm *date, char *summary, char *description,
-		struct date_list **head_ptr)
-{
-	struct plant_date *cal_entry;
-
-	cal_entry = make_calendar_entry(date, summary, description);
-	if (!cal_entry)
-		return 0;
-
-	if (!sort_in_one_date(cal_entry, head_ptr))
-		return 0;
-	return 1;
-}
-
-int add_sprouting_dates_to_list(struct plant *new_plant,
-		struct date_list **head_ptr)
-{
-	char *summary;
-	char *description;
-
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Expect sprouting seeds around",
-			new_plant->name);
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Sprouting: %s",
-			new_plant->name);
-	if (!insert_calendar_entry(&new_plant->sprouting_date,
-				summary, description, head_ptr))
-		return 0;
-
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Last chance for sprouting seeds",
-			new_plant->name);
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Check sprouts: %s",
-			new_plant->name);
-	if (!insert_calendar_entry(&new_plant->last_chance_sprouting_date,
-				summary, description, head_ptr))
-		return 0;
-	return 1;
-}
-
-/* Organize the dates in the plant into a larger sorted date list */
-int add_indoor_plant_dates_to_list(struct plant *new_plant,
-		struct date_list **head_ptr, int suppress_sprouting_dates)
-{
-	char *summary;
-	char *description;
-	float num_seeds;
-
-	if (!new_plant->num_weeks_indoors)
-		return 1;
-
-	if (!suppress_sprouting_dates) {
-		if (!add_sprouting_dates_to_list(new_plant, head_ptr))
-			return 0;
-		return 1;
-	}
-
-	/* Starting seeds indoors */
-	num_seeds = get_num_seeds_needed(new_plant);
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Start %i seed%s under grow lamp",
-			new_plant->name,
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "");
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Seed indoors: %s", new_plant->name);
-	if (!insert_calendar_entry(&new_plant->seeding_date,
-				summary, description, head_ptr))
-		return 0;
-
-	/* Separating seeds indoors */
-	if (new_plant->num_weeks_until_indoor_separation) {
-		description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-		if (!description)
-			return 0;
-		snprintf(description, MAX_NAME_LENGTH,
-				"%s -- Separate or move to a bigger indoor pot",
-				new_plant->name);
-		summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-		if (!summary)
-			return 0;
-		snprintf(summary, MAX_NAME_LENGTH,
-				"Separate: %s", new_plant->name);
-		if (!insert_calendar_entry(&new_plant->indoor_separation_date,
-					summary, description, head_ptr))
-			return 0;
-	}
-
-	/* Harden off seedlings */
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Start hardening off seedlings (leave them out during the day and bring them in at night)",
-			new_plant->name);
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Harden off: %s", new_plant->name);
-	if (!insert_calendar_entry(&new_plant->hardening_off_date,
-			       	summary, description, head_ptr))
-		return 0;
-
-	/* Transplant outdoors */
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	num_seeds = new_plant->num_plants_to_harvest;
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Transplant %i plant%s outdoors",
-			new_plant->name,
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "");
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Transplant: %s", new_plant->name);
-	if (!insert_calendar_entry(&new_plant->outdoor_planting_date,
-			       	summary, description, head_ptr))
-		return 0;
-	return 1;
-}
-
-int add_direct_sown_plant_dates_to_list(struct plant *new_plant,
-		struct date_list **head_ptr, int suppress_sprouting_dates)
-{
-	char *summary;
-	char *description;
-	float num_seeds;
-
-	if (new_plant->num_weeks_indoors)
-		return 1;
-
-	if (!suppress_sprouting_dates) {
-		if (!add_sprouting_dates_to_list(new_plant, head_ptr))
-			return 0;
-		return 1;
-	}
-
-	num_seeds = get_num_seeds_needed(new_plant);
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	snprintf(description, MAX_NAME_LENGTH,
-			"%s -- Direct sow %i seed%s outdoors",
-			new_plant->name,
-			(int) num_seeds,
-			(num_seeds > 1) ? "s" : "");
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Direct sow: %s", new_plant->name);
-	if (!insert_calendar_entry(&new_plant->outdoor_planting_date,
-				summary, description, head_ptr))
-		return 0;
-
-	if (new_plant->num_weeks_until_outdoor_separation) {
-		description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-		num_seeds = new_plant->num_plants_to_harvest;
-		snprintf(description, MAX_NAME_LENGTH,
-				"%s -- Thin to %i plant%s",
-				new_plant->name,
-				(int) num_seeds,
-				(num_seeds > 1) ? "s" : "");
-		summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-		if (!summary)
+		filenames[num_files] = copy_string(line);
+		if (!filenames[num_files++]) {
+			printf("Out of memory\n");
 			return 0;
-		snprintf(summary, MAX_NAME_LENGTH,
-				"Thin: %s", new_plant->name);
-		if (!insert_calendar_entry(&new_plant->outdoor_separation_date,
-					summary, description, head_ptr))
-			return 0;
-	}
-	return 1;
-}
-
-int add_harvest_dates_to_list(struct plant *new_plant,
-		struct date_list **head_ptr)
-{
-	char *summary;
-	char *description;
-	unsigned int num_plants;
-
-	summary = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!summary)
-		return 0;
-	snprintf(summary, MAX_NAME_LENGTH,
-			"Harvest: %s", new_plant->name);
-	description = malloc(sizeof(char)*MAX_NAME_LENGTH);
-	if (!description)
-		return 0;
-	num_plants = new_plant->num_plants_to_harvest;
-	if (new_plant->harvest_removes_plant)
-		snprintf(description, MAX_NAME_LENGTH,
-				"%s -- Harvest %u plant%s",
-				new_plant->name,
-				num_plants,
-				(num_plants > 1) ? "s": "");
-	else
-		snprintf(description, MAX_NAME_LENGTH,
-				"%s -- Start harvesting",
-				new_plant->name);
-	if (!insert_calendar_entry(&new_plant->harvest_date,
-			       	summary, description, head_ptr))
-		return 0;
-
-	return 1;
-}
-
-void print_month_and_year(struct tm *new_date)
-{
-	char string[MAX_NAME_LENGTH];
-	int chars_printed;
-
-	strftime(string, MAX_NAME_LENGTH,
-			"\n%B %Y\n", new_date);
-	chars_printed = printf(string);
-	/* Don't count the newline */
-	for(; chars_printed > 1; chars_printed--)
-		putchar('=');
-	printf("\n");
-}
-
-void make_icalendar(struct date_list *head)
-{
-	struct tm *new_date;
-	struct tm *now;
-	time_t now_time;
-	struct date_list *item;
-	char start_date[MAX_NAME_LENGTH];
-	char end_date[MAX_NAME_LENGTH];
-	char now_date[MAX_NAME_LENGTH];
-	char uid[4*MAX_NAME_LENGTH];
-	char ptr[MAX_NAME_LENGTH];
-
-	if (!head)
-		return;
-	
-	/* Standard ical stuff */ 
-	printf("BEGIN:VCALENDAR\r\n");
-	printf("VERSION:2.0\r\n");
-	printf("PRODID:-//Sarah Sharp//Garden Calendar Tool v0.1//EN\r\n");
-	/* Following RFC at http://www.ietf.org/rfc/rfc2445.txt */
-
-	for (item = head; item != NULL; item = item->next) {
-		new_date = item->cal_entry->date;
-		printf("BEGIN:VEVENT\r\n");
-
-		/* What to use as a unique ID?  Must be "globally unique
-		 * across icalendars.  Seconds since 1970 + hash of
-		 * name?  No requirement that plant names be unique
-		 * across one garden.
-		 */
-		time(&now_time);
-		now = localtime(&now_time);
-		strftime(uid, MAX_NAME_LENGTH, "%s", now);
-		snprintf(ptr, MAX_NAME_LENGTH, "%p@SSGCT", item);
-		strncat(uid, ptr, 4*MAX_NAME_LENGTH - 1);
-		printf("UID:%s\r\n", uid);
-
-		strftime(start_date, MAX_NAME_LENGTH, "%Y%m%d",
-				new_date);
-
-		/* Make the calendar entry last all day for now */
-		new_date->tm_mday += 1;
-		mktime(new_date);
-		strftime(end_date, MAX_NAME_LENGTH, "%Y%m%d",
-				new_date);
-
-		strftime(now_date, MAX_NAME_LENGTH, "%Y%m%dT%H%M%S",
-				now);
-		printf("DTSTAMP:%s\r\n", now_date);
-		printf("DTSTART;VALUE=DATE:%s\r\n", start_date);
-		printf("DTEND;VALUE=DATE:%s\r\n", end_date);
-		printf("SUMMARY:%s\r\n", item->cal_entry->summary);
-		printf("DESCRIPTION:%s\r\n", item->cal_entry->description);
-		new_date->tm_mday -= 1;
-		mktime(new_date);
-		printf("END:VEVENT\r\n");
-	}
-	printf("END:VCALENDAR\r\n");
-}
-
-void print_by_month_calendar(struct date_list *head)
-{
-	int cur_month, cur_year;
-	struct tm *old_date = NULL;
-	struct tm *new_date;
-	struct date_list *item;
-	char string[MAX_NAME_LENGTH];
-
-	if (!head)
-		return;
-
-	new_date = head->cal_entry->date;
-	print_month_and_year(new_date);
-	cur_month = new_date->tm_mon;
-	cur_year = new_date->tm_year;
-
-	for (item = head; item != NULL; item = item->next) {
-		new_date = item->cal_entry->date;
-		if (cur_month != new_date->tm_mon ||
-				cur_year != new_date->tm_year) {
-			printf("\n");
-			print_month_and_year(new_date);
-			cur_month = new_date->tm_mon;
-			cur_year = new_date->tm_year;
 		}
-		strftime(string, MAX_NAME_LENGTH, "%e (%a)",
-				new_date);
-		if (old_date == NULL ||
-				!dates_are_equal(old_date, new_date))
-			printf("\n   %s: %s\n", string,
-					item->cal_entry->description);
-		else
-			printf("             %s\n",
-					item->cal_entry->description);
-		old_date = new_date;
 	}
-}
 
-#define	BY_PLANT	(1 << 0)
-#define	BY_MONTH	(1 << 1)
-#define	BY_HARVEST	(1 << 2)
-#define	BY_SPROUTING	(1 << 3)
+	ret = print_seed_order(stdout, stderr, filenames, num_files, catalog,
+			stats, &num_skipped, &error);
+	if (!ret)
+		print_garden_error(stdout, &error);
+	else if (num_skipped)
+		fprintf(stderr, "Left out %lu rows planted relative to "
+				"the last frost\n", num_skipped);
+	while (num_files)
+		free(filenames[--num_files]);
+	free(filenames);
+	return ret;
+}
 
 int main (int argc, char *argv[])
 {
 	FILE *fp;
+	FILE *input;
+	struct garden_error error;
 	struct plant *new_plant;
-	struct date_list *sprouting_list_head = NULL;
-	struct date_list *action_list_head = NULL;
-	struct date_list *harvest_list_head = NULL;
+	struct calendar_lists lists = { NULL, NULL, NULL };
 	unsigned int chars_printed;
 	unsigned int calendar_bitmask = 0;
 	int i;
+	int ret;
 	int use_ical = 0;
+	struct variety_catalog *catalog = NULL;
+	struct plant_list all_plants = { NULL, 0, 0 };
+	struct garden_bed *beds = NULL;
+	unsigned int num_beds = 0;
+	int *plant_beds;
+	struct reminder_sink *sinks[16];
+	unsigned int num_sinks = 0;
+	struct region *regions = NULL;
+	unsigned int num_regions = 0;
+	struct sprout_stats *stats = NULL;
+#ifdef HAVE_CAIRO
+	char *wall_filename = NULL;
+	struct wall_calendar_fonts *fonts;
+#endif
 
 	if (argc < 2) {
 		printf("Help: plant <file> [output type] [options]...\n");
@@ -803,8 +100,28 @@ int main (int argc, char *argv[])
 		printf("  m for a by-month calendar\n");
 		printf("  h for a harvest calendar\n");
 		printf("  s for a seed sprouting calendar\n");
+		printf("  b <beds> for a plan of which garden bed gets each plant\n");
+		printf("  g for a daily table of how much room the plants take up\n");
+		printf("  r <sink> to run as a reminder server instead, reading\n");
+		printf("    add/remove/tick/status commands from <file> and sending\n");
+		printf("    reminders to the sink (- for stdout, unix:<socket>, or\n");
+		printf("    a file), which can be given more than once\n");
+		printf("  o to read a list of garden files from <file> instead,\n");
+		printf("    and print a table of the seeds of each variety they\n");
+		printf("    need each week\n");
+		printf("  w <file> for a printable wall calendar, as one PDF if\n");
+		printf("    the file ends in .pdf, or else as a PNG per month\n");
 		printf("Where [options] can be:\n");
 		printf("  i to use ical format instead of plain text\n");
+		printf("  c <catalog> to fill in short rows (name,number,date)\n");
+		printf("    from a variety catalog\n");
+		printf("  f <last frost table> to make the p, m, h, and s calendars\n");
+		printf("    for every region in the table, with rows planted\n");
+		printf("    relative to the last frost (like +14) moved to match\n");
+		printf("    (b, g, and w can't be used with it)\n");
+		printf("  l <observations> to use the germination rates and\n");
+		printf("    sprouting times gardeners have logged, instead of\n");
+		printf("    the ones on the seed packet\n");
 		return -1;
 	}
 	fp = fopen(argv[1], "r");
@@ -813,7 +130,7 @@ int main (int argc, char *argv[])
 		return -1;
 	}
 
-	for (i = 2; i < (2+4) && i < argc; i++) {
+	for (i = 2; i < argc; i++) {
 		if (!strcmp(argv[i], "p") ||
 				!strcmp(argv[i], "-p"))
 			calendar_bitmask |= BY_PLANT;
@@ -829,76 +146,186 @@ int main (int argc, char *argv[])
 		if (!strcmp(argv[i], "i") ||
 				!strcmp(argv[i], "-i"))
 			use_ical = 1;
-	}
-
-	while (1) {
-		new_plant = parse_and_create_plant(fp);
-		if (!new_plant)
-			break;
-		calculate_plant_dates(new_plant);
-		if (calendar_bitmask & BY_PLANT) {
-			printf("\n");
-			print_action_dates(new_plant);
-			printf("\n");
+		if (!strcmp(argv[i], "g") ||
+				!strcmp(argv[i], "-g"))
+			calendar_bitmask |= BY_GROWTH;
+		if (!strcmp(argv[i], "o") ||
+				!strcmp(argv[i], "-o"))
+			calendar_bitmask |= BY_SEED_ORDER;
+		if ((!strcmp(argv[i], "c") ||
+				!strcmp(argv[i], "-c")) && i + 1 < argc) {
+			input = open_input(argv[++i]);
+			if (!input)
+				return -1;
+			catalog = load_variety_catalog(input, &error);
+			fclose(input);
+			if (!catalog) {
+				print_garden_error(stdout, &error);
+				return -1;
+			}
+		}
+		if ((!strcmp(argv[i], "w") ||
+				!strcmp(argv[i], "-w")) && i + 1 < argc) {
+#ifdef HAVE_CAIRO
+			wall_filename = argv[++i];
+			calendar_bitmask |= BY_WALL;
+#else
+			printf("Wall calendars need cairo (make calpic).\n");
+			return -1;
+#endif
 		}
-		if (calendar_bitmask & BY_MONTH) {
-			if (!add_indoor_plant_dates_to_list(new_plant,
-					&action_list_head, 1))
+		if ((!strcmp(argv[i], "r") ||
+				!strcmp(argv[i], "-r")) && i + 1 < argc &&
+				num_sinks < sizeof(sinks)/sizeof(sinks[0])) {
+			sinks[num_sinks] = make_reminder_sink(argv[++i],
+					&error);
+			if (!sinks[num_sinks++]) {
+				print_garden_error(stdout, &error);
 				return -1;
-			if (!add_direct_sown_plant_dates_to_list(new_plant,
-					&action_list_head, 1))
+			}
+			calendar_bitmask |= BY_REMINDER;
+		}
+		if ((!strcmp(argv[i], "f") ||
+				!strcmp(argv[i], "-f")) && i + 1 < argc) {
+			input = open_input(argv[++i]);
+			if (!input)
 				return -1;
+			regions = load_regions(input, &num_regions, &error);
+			fclose(input);
+			if (!regions) {
+				print_garden_error(stdout, &error);
+				return -1;
+			}
+			calendar_bitmask |= BY_REGION;
 		}
-		if (calendar_bitmask & BY_SPROUTING) {
-			if (!add_indoor_plant_dates_to_list(new_plant,
-					&sprouting_list_head, 0))
+		if ((!strcmp(argv[i], "l") ||
+				!strcmp(argv[i], "-l")) && i + 1 < argc) {
+			if (!stats)
+				stats = make_sprout_stats();
+			if (!stats) {
+				printf("Out of memory\n");
+				return -1;
+			}
+			input = open_input(argv[++i]);
+			if (!input)
 				return -1;
-			if (!add_direct_sown_plant_dates_to_list(new_plant,
-					&sprouting_list_head, 0))
+			ret = load_sprout_observations(stats, input, &error);
+			fclose(input);
+			if (!ret) {
+				print_garden_error(stdout, &error);
 				return -1;
+			}
 		}
-		if (calendar_bitmask & BY_HARVEST) {
-			if (!add_harvest_dates_to_list(new_plant,
-					&harvest_list_head))
+		if ((!strcmp(argv[i], "b") ||
+				!strcmp(argv[i], "-b")) && i + 1 < argc) {
+			input = open_input(argv[++i]);
+			if (!input)
+				return -1;
+			beds = load_garden_beds(input, &num_beds, &error);
+			fclose(input);
+			if (!beds) {
+				print_garden_error(stdout, &error);
 				return -1;
+			}
+			calendar_bitmask |= BY_BED;
 		}
 	}
 
-	if (calendar_bitmask & BY_MONTH) {
-		if (use_ical)
-			make_icalendar(action_list_head);
-		else {
-			chars_printed = printf("\n\nGarden Action Items Calendar\n");
-			for(; chars_printed > 3; chars_printed--)
-				putchar('*');
-			printf("\n");
-			print_by_month_calendar(action_list_head);
-		}
+	/* A template with rows relative to the last frost has no beds,
+	 * growth, or wall calendar of its own, only one per region.
+	 */
+	if ((calendar_bitmask & BY_REGION) &&
+			(calendar_bitmask & (BY_BED | BY_GROWTH | BY_WALL))) {
+		printf("b, g, and w can't be used with f <last frost table>\n");
+		return -1;
 	}
 
-	if (calendar_bitmask & BY_SPROUTING) {
-		if (use_ical)
-			make_icalendar(sprouting_list_head);
-		else {
-			chars_printed = printf("\n\nSeed Sprouting Calendar\n");
-			for(; chars_printed > 3; chars_printed--)
-				putchar('*');
-			printf("\n");
-			print_by_month_calendar(sprouting_list_head);
+	if (calendar_bitmask & BY_REMINDER) {
+		ret = run_reminder_scheduler(fp, stderr, sinks, num_sinks,
+				catalog, stats);
+		for (i = 0; i < num_sinks; i++)
+			close_reminder_sink(sinks[i]);
+		return ret ? 0 : -1;
+	}
+
+	if (calendar_bitmask & BY_SEED_ORDER)
+		return make_seed_order(fp, catalog, stats) ? 0 : -1;
+
+	while (1) {
+		new_plant = parse_and_create_plant(fp, catalog, &error);
+		if (!new_plant) {
+			/* Make what we can of the rows before a bad one */
+			if (error.code != GARDEN_OK)
+				print_garden_error(stdout, &error);
+			break;
+		}
+		if (new_plant->relative_to_last_frost && !regions) {
+			printf("%s is planted relative to the last frost, "
+					"which needs f <last frost table>\n",
+					new_plant->name);
+			return -1;
 		}
+		if (stats)
+			use_sprout_stats(stats, new_plant, NULL);
+		calculate_plant_dates(new_plant);
+		if (calendar_bitmask & (BY_BED | BY_GROWTH | BY_REGION)) {
+			if (!add_plant_to_list(&all_plants, new_plant))
+				return -1;
+		}
+		if (calendar_bitmask & BY_REGION)
+			continue;
+		if (!add_plant_to_calendars(stdout, new_plant,
+					calendar_bitmask, &lists))
+			return -1;
 	}
 
-	if (calendar_bitmask & BY_HARVEST) {
-		if (use_ical)
-			make_icalendar(harvest_list_head);
-		else {
-			chars_printed = printf("\n\nHarvest Calendar\n");
-			for(; chars_printed > 3; chars_printed--)
-				putchar('*');
-			printf("\n");
-			print_by_month_calendar(harvest_list_head);
+	if (calendar_bitmask & BY_REGION)
+		return make_region_calendars(stdout, &all_plants, regions,
+				num_regions, calendar_bitmask, use_ical,
+				stats) ? 0 : -1;
+
+	print_calendars(stdout, &lists, calendar_bitmask, use_ical);
+
+#ifdef HAVE_CAIRO
+	if (calendar_bitmask & BY_WALL) {
+		fonts = make_wall_calendar_fonts(&error);
+		ret = fonts && make_wall_calendar(lists.action,
+				wall_filename, fonts, &error);
+		if (fonts)
+			free_wall_calendar_fonts(fonts);
+		if (!ret) {
+			print_garden_error(stdout, &error);
+			return -1;
 		}
 	}
+#endif
+
+	if (calendar_bitmask & BY_BED) {
+		plant_beds = malloc(sizeof(*plant_beds)*
+				(all_plants.num_plants + 1));
+		if (!plant_beds)
+			return -1;
+		if (!allocate_garden_beds(all_plants.plants,
+					all_plants.num_plants,
+					beds, num_beds, plant_beds))
+			return -1;
+		chars_printed = printf("\n\nGarden Bed Plan\n");
+		for(; chars_printed > 3; chars_printed--)
+			putchar('*');
+		printf("\n");
+		print_bed_allocation(stdout, all_plants.plants,
+				all_plants.num_plants, beds, num_beds,
+				plant_beds);
+	}
+
+	if (calendar_bitmask & BY_GROWTH) {
+		if (calendar_bitmask != BY_GROWTH)
+			printf("\n\n");
+		if (!print_growth_simulation(stdout, all_plants.plants,
+					all_plants.num_plants))
+			return -1;
+	}
 
 	return 0;
 }
+
@@ -0,0 +1,171 @@
+#define _XOPEN_SOURCE 500 /* glibc2 needs this */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <stddef.h>
+#include "gardengeek.h"
+
+/****************** Region batch functions ******************/
+
+struct region *load_regions(FILE *fp, unsigned int *num_regions,
+		struct garden_error *error)
+{
+	struct region *regions = NULL;
+	struct region *tmp;
+	struct tm date;
+	unsigned int list_size = 0;
+	char string[MAX_NAME_LENGTH];
+
+	*num_regions = 0;
+	while (skip_comment_lines(fp)) {
+		if (*num_regions == list_size) {
+			list_size = list_size ? list_size*2 : 64;
+			tmp = realloc(regions, sizeof(*regions)*list_size);
+			if (!tmp) {
+				set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+				free_regions(regions, *num_regions);
+				return NULL;
+			}
+			regions = tmp;
+		}
+		if (!copy_word_from_file(fp, &regions[*num_regions].name))
+			break;
+		memset(&date, 0, sizeof(date));
+		string[0] = '\0';
+		fscanf(fp, "%" MAX_NAME_FIELD "[^,\n]", string);
+		fscanf(fp, "%*[^,\n]");
+		fgetc(fp);
+		if (!strptime(string, "%Y-%m-%d", &date)) {
+			set_garden_error(error, GARDEN_BAD_DATE,
+					regions[*num_regions].name);
+			free_regions(regions, *num_regions + 1);
+			return NULL;
+		}
+		regions[*num_regions].last_frost_day =
+			date_to_day_number(&date);
+		(*num_regions)++;
+	}
+	if (!*num_regions) {
+		set_garden_error(error, GARDEN_EMPTY_FILE, NULL);
+		free(regions);
+		return NULL;
+	}
+	return regions;
+}
+
+void free_regions(struct region *regions, unsigned int num_regions)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_regions; i++)
+		free(regions[i].name);
+	free(regions);
+}
+
+/* The dates calculate_plant_dates() fills in, plus the planting date */
+static const size_t plant_date_fields[] = {
+	offsetof(struct plant, outdoor_planting_date),
+	offsetof(struct plant, seeding_date),
+	offsetof(struct plant, sprouting_date),
+	offsetof(struct plant, last_chance_sprouting_date),
+	offsetof(struct plant, indoor_separation_date),
+	offsetof(struct plant, hardening_off_date),
+	offsetof(struct plant, outdoor_separation_date),
+	offsetof(struct plant, harvest_date),
+};
+#define NUM_PLANT_DATES \
+	(sizeof(plant_date_fields) / sizeof(plant_date_fields[0]))
+
+#define plant_date(plant, field) \
+	((struct tm *) ((char *) (plant) + plant_date_fields[field]))
+
+/*
+ * Make the same garden's calendars for every region in one pass.
+ *
+ * The template is only parsed and calculated once, with relative rows
+ * planted around REFERENCE_LAST_FROST.  Every date of a relative row is
+ * then just a number of days from the last frost, so each region's dates
+ * are one add per date, done a whole column of plants at a time.
+ * Rows with an absolute date are the same everywhere.
+ *
+ * With sprouting statistics, each region's rows also get the germination
+ * rate and sprouting dates gardeners have seen in that region.
+ */
+int make_region_calendars(FILE *out, struct plant_list *garden,
+		struct region *regions, unsigned int num_regions,
+		unsigned int calendar_bitmask, int use_ical,
+		struct sprout_stats *stats)
+{
+	struct calendar_lists lists;
+	struct plant **relative;
+	int *offsets[NUM_PLANT_DATES];
+	int *days;
+	unsigned int num_relative = 0;
+	unsigned int i, r, field;
+	unsigned int chars_printed;
+	char string[MAX_NAME_LENGTH];
+	struct tm date;
+	int last_frost;
+	int ret = 0;
+
+	relative = malloc(sizeof(*relative)*(garden->num_plants + 1));
+	days = malloc(sizeof(*days)*(garden->num_plants + 1));
+	memset(offsets, 0, sizeof(offsets));
+	if (!relative || !days)
+		goto out;
+	for (i = 0; i < garden->num_plants; i++)
+		if (garden->plants[i]->relative_to_last_frost)
+			relative[num_relative++] = garden->plants[i];
+
+	for (field = 0; field < NUM_PLANT_DATES; field++) {
+		offsets[field] = malloc(sizeof(int)*(num_relative + 1));
+		if (!offsets[field])
+			goto out;
+		for (i = 0; i < num_relative; i++)
+			offsets[field][i] = date_to_day_number(
+					plant_date(relative[i], field)) -
+				REFERENCE_LAST_FROST;
+	}
+
+	for (r = 0; r < num_regions; r++) {
+		last_frost = regions[r].last_frost_day;
+		for (field = 0; field < NUM_PLANT_DATES; field++) {
+			for (i = 0; i < num_relative; i++)
+				days[i] = last_frost + offsets[field][i];
+			for (i = 0; i < num_relative; i++)
+				day_number_to_date(days[i],
+						plant_date(relative[i], field));
+		}
+		for (i = 0; stats && i < garden->num_plants; i++)
+			if (use_sprout_stats(stats, garden->plants[i],
+						regions[r].name))
+				calculate_sprouting_dates(garden->plants[i]);
+
+		if (!use_ical) {
+			day_number_to_date(last_frost, &date);
+			strftime(string, MAX_NAME_LENGTH, "%a, %b. %d, %Y",
+					&date);
+			chars_printed = fprintf(out, "\n\n%s (last frost %s)\n",
+					regions[r].name, string);
+			for(; chars_printed > 3; chars_printed--)
+				fputc('#', out);
+			fprintf(out, "\n");
+		}
+
+		memset(&lists, 0, sizeof(lists));
+		for (i = 0; i < garden->num_plants; i++)
+			if (!add_plant_to_calendars(out, garden->plants[i],
+						calendar_bitmask, &lists))
+				goto out;
+		print_calendars(out, &lists, calendar_bitmask, use_ical);
+		free_calendar_lists(&lists);
+	}
+	ret = 1;
+out:
+	for (field = 0; field < NUM_PLANT_DATES; field++)
+		free(offsets[field]);
+	free(relative);
+	free(days);
+	return ret;
+}
@@ -0,0 +1,656 @@
+#define _GNU_SOURCE /* for strptime() and fopencookie() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "gardengeek.h"
+
+/****************** Reminder scheduler functions ******************/
+
+/*
+ * Reminders wait in a hierarchical timer wheel, like the kernel's timer
+ * wheel but ticking once a day.  The first level has a slot for each of the
+ * next 64 days, the next level a slot for each 64 days after that, and so
+ * on.  Adding or removing a reminder is O(1), and each day only looks at
+ * one slot.  When the first level wraps around, the next level's slot for
+ * the coming 64 days is cascaded down into the first level.
+ */
+#define WHEEL_BITS		6
+#define WHEEL_SIZE		(1 << WHEEL_BITS)
+#define WHEEL_MASK		(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS		4
+#define MAX_WHEEL_DAYS		((1U << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define GARDEN_BUCKETS		4096
+
+struct reminder_wheel {
+	unsigned int		now;		/* next day to run */
+	int			ran_today;	/* now - 1 has been run */
+	struct reminder		*slots[WHEEL_LEVELS][WHEEL_SIZE];
+	struct garden		*gardens[GARDEN_BUCKETS];
+	unsigned long		num_pending;
+	struct reminder_sink	**sinks;
+	unsigned int		num_sinks;
+	struct schedule_cache	*cache;
+};
+
+static void add_reminder_to_wheel(struct reminder_wheel *wheel,
+		struct reminder *reminder)
+{
+	unsigned int days = reminder->day - wheel->now;
+	unsigned int day = reminder->day;
+	struct reminder **slot;
+
+	if (days < WHEEL_SIZE) {
+		slot = &wheel->slots[0][day & WHEEL_MASK];
+	} else if (days < 1 << (2 * WHEEL_BITS)) {
+		slot = &wheel->slots[1][(day >> WHEEL_BITS) & WHEEL_MASK];
+	} else if (days < 1 << (3 * WHEEL_BITS)) {
+		slot = &wheel->slots[2][(day >> (2 * WHEEL_BITS)) & WHEEL_MASK];
+	} else {
+		/* Anything further out waits in the last slot and cascades */
+		if (days > MAX_WHEEL_DAYS)
+			day = wheel->now + MAX_WHEEL_DAYS;
+		slot = &wheel->slots[3][(day >> (3 * WHEEL_BITS)) & WHEEL_MASK];
+	}
+
+	reminder->next = *slot;
+	if (*slot)
+		(*slot)->pprev = &reminder->next;
+	reminder->pprev = slot;
+	*slot = reminder;
+}
+
+static void remove_reminder_from_slot(struct reminder *reminder)
+{
+	*reminder->pprev = reminder->next;
+	if (reminder->next)
+		reminder->next->pprev = reminder->pprev;
+}
+
+static void remove_reminder_from_wheel(struct reminder *reminder)
+{
+	remove_reminder_from_slot(reminder);
+	*reminder->garden_pprev = reminder->garden_next;
+	if (reminder->garden_next)
+		reminder->garden_next->garden_pprev = reminder->garden_pprev;
+}
+
+static void free_reminder(struct reminder_wheel *wheel,
+		struct reminder *reminder)
+{
+	put_schedule(wheel->cache, reminder->schedule);
+	free(reminder);
+}
+
+/* Move one slot of a higher level down to where it belongs now */
+static unsigned int cascade_reminders(struct reminder_wheel *wheel,
+		unsigned int level, unsigned int index)
+{
+	struct reminder *reminder = wheel->slots[level][index];
+	struct reminder *next;
+
+	wheel->slots[level][index] = NULL;
+	for (; reminder; reminder = next) {
+		next = reminder->next;
+		add_reminder_to_wheel(wheel, reminder);
+	}
+	return index;
+}
+
+static void send_reminder(struct reminder_wheel *wheel,
+		struct reminder *reminder)
+{
+	struct reminder_sink *sink;
+	unsigned int i;
+
+	for (i = 0; i < wheel->num_sinks; i++) {
+		sink = wheel->sinks[i];
+		if (!sink->failed && !sink->send(sink, reminder))
+			sink->failed = 1;
+	}
+}
+
+static void flush_reminder_sinks(struct reminder_wheel *wheel)
+{
+	struct reminder_sink *sink;
+	unsigned int i;
+
+	for (i = 0; i < wheel->num_sinks; i++) {
+		sink = wheel->sinks[i];
+		if (!sink->failed && !sink->flush(sink))
+			sink->failed = 1;
+	}
+}
+
+/* Send out everything due today, and move on to tomorrow. */
+static void run_reminder_day(struct reminder_wheel *wheel)
+{
+	struct reminder *reminder;
+	unsigned int index = wheel->now & WHEEL_MASK;
+	unsigned int level;
+
+	if (!index) {
+		for (level = 1; level < WHEEL_LEVELS; level++)
+			if (cascade_reminders(wheel, level,
+					(wheel->now >> (level * WHEEL_BITS)) &
+					WHEEL_MASK))
+				break;
+	}
+
+	while ((reminder = wheel->slots[0][index])) {
+		/* Capped reminders from far in the future go around again */
+		if (reminder->day != wheel->now) {
+			remove_reminder_from_slot(reminder);
+			add_reminder_to_wheel(wheel, reminder);
+			continue;
+		}
+		remove_reminder_from_wheel(reminder);
+		send_reminder(wheel, reminder);
+		wheel->num_pending--;
+		free_reminder(wheel, reminder);
+	}
+	flush_reminder_sinks(wheel);
+	wheel->now++;
+	wheel->ran_today = 1;
+}
+
+void run_reminders_until(struct reminder_wheel *wheel, unsigned int day)
+{
+	while ((int) (day - wheel->now) >= 0)
+		run_reminder_day(wheel);
+}
+
+static struct garden **find_garden(struct reminder_wheel *wheel, char *name)
+{
+	struct garden **garden_ptr;
+	uint64_t hash = hash_name(name, strlen(name));
+
+	for (garden_ptr = &wheel->gardens[hash % GARDEN_BUCKETS];
+			*garden_ptr; garden_ptr = &(*garden_ptr)->next)
+		if ((*garden_ptr)->hash == hash &&
+				!strcmp((*garden_ptr)->name, name))
+			break;
+	return garden_ptr;
+}
+
+static void free_garden(struct reminder_wheel *wheel,
+		struct garden **garden_ptr)
+{
+	struct garden *garden = *garden_ptr;
+	struct reminder *reminder;
+
+	while ((reminder = garden->reminders)) {
+		remove_reminder_from_wheel(reminder);
+		free_reminder(wheel, reminder);
+		wheel->num_pending--;
+	}
+	*garden_ptr = garden->next;
+	free(garden->name);
+	free(garden);
+}
+
+void remove_garden(struct reminder_wheel *wheel, char *name)
+{
+	struct garden **garden_ptr = find_garden(wheel, name);
+
+	if (*garden_ptr)
+		free_garden(wheel, garden_ptr);
+}
+
+/* A wheel starting today, with a schedule cache its gardens share */
+struct reminder_wheel *make_reminder_wheel(struct reminder_sink **sinks,
+		unsigned int num_sinks, unsigned int today)
+{
+	struct reminder_wheel *wheel;
+
+	wheel = calloc(1, sizeof(*wheel));
+	if (!wheel)
+		return NULL;
+	wheel->sinks = sinks;
+	wheel->num_sinks = num_sinks;
+	wheel->now = today;
+	wheel->cache = make_schedule_cache(SCHEDULE_CACHE_ENTRIES);
+	if (!wheel->cache) {
+		free(wheel);
+		return NULL;
+	}
+	return wheel;
+}
+
+/* Drop every garden's reminders without sending them.  The sinks are
+ * left open.
+ */
+void free_reminder_wheel(struct reminder_wheel *wheel)
+{
+	unsigned int i;
+
+	for (i = 0; i < GARDEN_BUCKETS; i++)
+		while (wheel->gardens[i])
+			free_garden(wheel, &wheel->gardens[i]);
+	free_schedule_cache(wheel->cache);
+	free(wheel);
+}
+
+/*
+ * Look up the garden's action items and harvest dates, and wait for
+ * the ones that haven't happened yet.  If today's reminders have
+ * already gone out, the garden's ones for today are sent straight away
+ * instead.  A garden that's added again
+ * replaces the old one.  Gardens with the same plants share the
+ * schedule cache's copy of each plant's entries.  With sprouting
+ * statistics (stats can be NULL), plants get the germination rates and
+ * sprouting times gardeners have seen before they're looked up.
+ */
+int add_garden(struct reminder_wheel *wheel, char *name, FILE *fp,
+		struct variety_catalog *catalog, struct sprout_stats *stats,
+		struct garden_error *error)
+{
+	struct garden *garden;
+	struct plant *new_plant;
+	struct reminder *reminder;
+	struct reminder today;
+	struct schedule *schedule;
+	struct schedule_event *event;
+	struct garden_error plant_error;
+	unsigned int i;
+	int sent = 0;
+	int ret = 1;
+
+	remove_garden(wheel, name);
+
+	garden = malloc(sizeof(*garden));
+	if (!garden) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return 0;
+	}
+	garden->name = copy_string(name);
+	garden->hash = hash_name(name, strlen(name));
+	garden->reminders = NULL;
+	garden->next = wheel->gardens[garden->hash % GARDEN_BUCKETS];
+	wheel->gardens[garden->hash % GARDEN_BUCKETS] = garden;
+	memset(&today, 0, sizeof(today));
+
+	while (ret) {
+		new_plant = parse_and_create_plant(fp, catalog, &plant_error);
+		if (!new_plant) {
+			if (plant_error.code == GARDEN_OK)
+				break;
+			if (error)
+				*error = plant_error;
+			ret = 0;
+			break;
+		}
+		if (stats)
+			use_sprout_stats(stats, new_plant, NULL);
+		schedule = get_schedule(wheel->cache, new_plant);
+		free_plant(new_plant);
+		if (!schedule) {
+			set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+			ret = 0;
+			break;
+		}
+
+		for (i = 0; i < schedule->num_events; i++) {
+			event = &schedule->events[i];
+			if ((int) (event->day - wheel->now) < 0) {
+				if (!wheel->ran_today ||
+						event->day != wheel->now - 1)
+					continue;
+				today.garden = garden;
+				today.day = event->day;
+				today.summary = event->summary;
+				today.description = event->description;
+				send_reminder(wheel, &today);
+				sent = 1;
+				continue;
+			}
+			reminder = malloc(sizeof(*reminder));
+			if (!reminder) {
+				set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+				ret = 0;
+				break;
+			}
+			hold_schedule(wheel->cache, schedule);
+			reminder->garden = garden;
+			reminder->day = event->day;
+			reminder->schedule = schedule;
+			reminder->summary = event->summary;
+			reminder->description = event->description;
+			reminder->garden_next = garden->reminders;
+			if (garden->reminders)
+				garden->reminders->garden_pprev =
+					&reminder->garden_next;
+			reminder->garden_pprev = &garden->reminders;
+			garden->reminders = reminder;
+			add_reminder_to_wheel(wheel, reminder);
+			wheel->num_pending++;
+		}
+		put_schedule(wheel->cache, schedule);
+	}
+	if (sent)
+		flush_reminder_sinks(wheel);
+	return ret;
+}
+
+static int send_reminder_to_stream(struct reminder_sink *sink,
+		struct reminder *reminder)
+{
+	struct tm date;
+	char string[MAX_NAME_LENGTH];
+
+	day_number_to_date(reminder->day, &date);
+	strftime(string, MAX_NAME_LENGTH, "%Y-%m-%d", &date);
+	return fprintf(sink->fp, "%s %s: %s\n", string,
+			reminder->garden->name, reminder->description) > 0;
+}
+
+static int flush_stream(struct reminder_sink *sink)
+{
+	return fflush(sink->fp) == 0;
+}
+
+/*
+ * Socket sinks are written with send() rather than write(), so a listener
+ * that goes away is a write error instead of a SIGPIPE that kills the
+ * server.
+ */
+static ssize_t write_socket(void *cookie, const char *buf, size_t size)
+{
+	ssize_t n;
+
+	do {
+		n = send((int) (intptr_t) cookie, buf, size, MSG_NOSIGNAL);
+	} while (n < 0 && errno == EINTR);
+	return n;
+}
+
+static int close_socket(void *cookie)
+{
+	return close((int) (intptr_t) cookie);
+}
+
+static const cookie_io_functions_t socket_functions = {
+	.write = write_socket,
+	.close = close_socket,
+};
+
+/*
+ * "-" is stdout, "unix:<path>" is a local socket some other program is
+ * listening on, and anything else is a file to append to.
+ */
+struct reminder_sink *make_reminder_sink(char *name,
+		struct garden_error *error)
+{
+	struct reminder_sink *sink;
+	struct sockaddr_un addr;
+	int fd;
+
+	sink = malloc(sizeof(*sink));
+	if (!sink) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return NULL;
+	}
+	sink->send = send_reminder_to_stream;
+	sink->flush = flush_stream;
+	sink->failed = 0;
+
+	if (!strcmp(name, "-")) {
+		sink->fp = stdout;
+	} else if (!strncmp(name, "unix:", 5)) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, name + 5, sizeof(addr.sun_path) - 1);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, (struct sockaddr *) &addr,
+					sizeof(addr)) < 0) {
+			set_garden_error(error, GARDEN_NO_CONNECTION,
+					name + 5);
+			if (fd >= 0)
+				close(fd);
+			free(sink);
+			return NULL;
+		}
+		sink->fp = fopencookie((void *) (intptr_t) fd, "w",
+				socket_functions);
+		if (!sink->fp)
+			close(fd);
+	} else {
+		sink->fp = fopen(name, "a");
+	}
+	if (!sink->fp) {
+		set_garden_error(error, GARDEN_BAD_FILE, name);
+		free(sink);
+		return NULL;
+	}
+	return sink;
+}
+
+/* Close a sink from make_reminder_sink().  Returns 0 if it didn't flush. */
+int close_reminder_sink(struct reminder_sink *sink)
+{
+	int ret;
+
+	if (sink->fp == stdout)
+		ret = fflush(sink->fp) == 0;
+	else
+		ret = fclose(sink->fp) == 0;
+	free(sink);
+	return ret;
+}
+
+static unsigned int get_today(void)
+{
+	struct tm today;
+	time_t now_time;
+
+	time(&now_time);
+	localtime_r(&now_time, &today);
+	return date_to_day_number(&today);
+}
+
+/* Milliseconds until midnight, when the next day's reminders are due */
+static int get_millis_until_tomorrow(void)
+{
+	struct tm tomorrow;
+	time_t now_time;
+
+	time(&now_time);
+	localtime_r(&now_time, &tomorrow);
+	tomorrow.tm_mday++;
+	tomorrow.tm_hour = 0;
+	tomorrow.tm_min = 0;
+	tomorrow.tm_sec = 0;
+	tomorrow.tm_isdst = -1;
+	return (mktime(&tomorrow) - now_time) * 1000 + 1000;
+}
+
+/*
+ * Commands are read with read() into our own buffer rather than with
+ * stdio, so the server can tell whether there's a whole command waiting
+ * before it sleeps in poll().  (stdio would pull several commands off a
+ * pipe or socket at once and leave the fd looking idle.)
+ */
+#define COMMAND_LINE_LENGTH	(3*MAX_NAME_LENGTH)
+
+struct command_reader {
+	int		fd;
+	char		buf[COMMAND_LINE_LENGTH];
+	size_t		len;
+	int		too_long;	/* throwing away the rest of a line */
+	int		eof;
+};
+
+/*
+ * Take the next whole line out of the buffer, without its newline.
+ * Returns 1 for a line, 0 if there isn't a whole line buffered yet,
+ * and -1 for a line too long to fit, which is thrown away.
+ */
+static int take_command_line(struct command_reader *reader, char *line)
+{
+	char *newline = memchr(reader->buf, '\n', reader->len);
+	size_t n;
+	int ret;
+
+	if (!newline && !(reader->eof && (reader->len || reader->too_long))) {
+		if (reader->len == sizeof(reader->buf)) {
+			reader->too_long = 1;
+			reader->len = 0;
+		}
+		return 0;
+	}
+	/* The last line might not end in a newline */
+	n = newline ? newline - reader->buf : reader->len;
+	ret = reader->too_long ? -1 : 1;
+	if (ret == 1) {
+		memcpy(line, reader->buf, n);
+		line[n] = '\0';
+	}
+	if (newline)
+		n++;
+	memmove(reader->buf, reader->buf + n, reader->len - n);
+	reader->len -= n;
+	reader->too_long = 0;
+	return ret;
+}
+
+static void fill_command_reader(struct command_reader *reader)
+{
+	ssize_t n;
+
+	do {
+		n = read(reader->fd, reader->buf + reader->len,
+				sizeof(reader->buf) - reader->len);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0)
+		reader->eof = 1;
+	else
+		reader->len += n;
+}
+
+/*
+ * Run the reminder server, reading commands from fp:
+ *
+ *   add <garden> <plant file>	start (or restart) reminders for a garden
+ *   remove <garden>		stop reminding a garden
+ *   tick <YYYY-MM-DD>		pretend the date is now this day (this can
+ *				only go back in time before any gardens
+ *				are added)
+ *   status			print how many reminders are waiting, which
+ *				sinks have failed, and how well the
+ *				schedule cache is doing
+ *
+ * Status and anything that goes wrong are written to log.
+ * The server follows the real clock until it gets a tick command.  At the
+ * end of the commands, a server on the real clock keeps sending reminders
+ * until there aren't any left.
+ */
+int run_reminder_scheduler(FILE *fp, FILE *log,
+		struct reminder_sink **sinks, unsigned int num_sinks,
+		struct variety_catalog *catalog, struct sprout_stats *stats)
+{
+	struct reminder_wheel *wheel;
+	struct command_reader *reader;
+	struct garden_error error;
+	struct pollfd pfd;
+	struct tm date;
+	FILE *garden_fp;
+	/* No word in a line can be longer than the line */
+	char line[COMMAND_LINE_LENGTH];
+	char command[COMMAND_LINE_LENGTH];
+	char name[COMMAND_LINE_LENGTH];
+	char filename[COMMAND_LINE_LENGTH];
+	int real_clock = 1;
+	unsigned int day;
+	unsigned int i;
+	int ret;
+
+	wheel = make_reminder_wheel(sinks, num_sinks, get_today());
+	reader = calloc(1, sizeof(*reader));
+	if (!wheel || !reader) {
+		if (wheel)
+			free_reminder_wheel(wheel);
+		free(reader);
+		return 0;
+	}
+	reader->fd = fileno(fp);
+
+	pfd.fd = reader->fd;
+	pfd.events = POLLIN;
+	while (1) {
+		ret = take_command_line(reader, line);
+		if (ret < 0) {
+			fprintf(log, "Command too long\n");
+			continue;
+		}
+		if (ret == 0) {
+			if (reader->eof)
+				break;
+			if (real_clock) {
+				run_reminders_until(wheel, get_today());
+				/* Wake up at midnight even if no commands come */
+				ret = poll(&pfd, 1, get_millis_until_tomorrow());
+				if (ret == 0)
+					continue;
+			}
+			fill_command_reader(reader);
+			continue;
+		}
+
+		if (sscanf(line, "%s", command) != 1 || command[0] == '#')
+			continue;
+		memset(&date, 0, sizeof(date));
+		if (!strcmp(command, "add") &&
+				sscanf(line, "%*s %s %s", name, filename) == 2) {
+			garden_fp = fopen(filename, "r");
+			if (!garden_fp)
+				set_garden_error(&error, GARDEN_BAD_FILE,
+						filename);
+			if (!garden_fp || !add_garden(wheel, name, garden_fp,
+						catalog, stats, &error)) {
+				fprintf(log, "Couldn't add garden %s: ", name);
+				print_garden_error(log, &error);
+			}
+			if (garden_fp)
+				fclose(garden_fp);
+		} else if (!strcmp(command, "remove") &&
+				sscanf(line, "%*s %s", name) == 1) {
+			remove_garden(wheel, name);
+		} else if (!strcmp(command, "tick") &&
+				sscanf(line, "%*s %s", name) == 1 &&
+				strptime(name, "%Y-%m-%d", &date)) {
+			real_clock = 0;
+			day = date_to_day_number(&date);
+			/* Only an empty wheel can go back in time */
+			if ((int) (day - wheel->now) < 0 && !wheel->num_pending)
+				wheel->now = day;
+			run_reminders_until(wheel, day);
+		} else if (!strcmp(command, "status")) {
+			fprintf(log, "%lu reminders waiting\n",
+					wheel->num_pending);
+			for (i = 0; i < num_sinks; i++)
+				if (sinks[i]->failed)
+					fprintf(log, "Reminder sink %u failed, "
+							"and was dropped\n",
+							i + 1);
+			print_schedule_cache_stats(log, wheel->cache);
+		} else {
+			fprintf(log, "Unknown command: %s\n", line);
+		}
+	}
+
+	free(reader);
+
+	while (real_clock && wheel->num_pending) {
+		poll(NULL, 0, get_millis_until_tomorrow());
+		run_reminders_until(wheel, get_today());
+	}
+	free_reminder_wheel(wheel);
+	return 1;
+}
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "gardengeek.h"
+
+/****************** Schedule cache functions ******************/
+
+/*
+ * Lots of gardens grow the same variety, planted on the same day.  The
+ * schedule cache remembers the dates and calendar entries worked out for
+ * each distinct plant row, so the next garden with that row gets them
+ * without recalculating or re-rendering anything.
+ *
+ * Entries are looked up by everything in the row that the dates and
+ * entries depend on.  Users hold a reference to the entry, so they can keep
+ * pointing at its strings.  The cache holds at most max_entries; past that
+ * the least recently used entry is dropped, and freed once nobody is using
+ * it any more.  One mutex protects the whole cache, so any number of
+ * threads can share it.
+ *
+ * The reminder server is the only user.  The region batch already
+ * calculates each template row once and moves it to each region by adding
+ * days, and the seed order only needs the seeding day, which is one
+ * subtraction; a cache lookup would cost both of them more than it saves.
+ */
+#define SCHEDULE_CACHE_BUCKETS	65536
+
+struct schedule_cache {
+	pthread_mutex_t		lock;
+	struct schedule		*buckets[SCHEDULE_CACHE_BUCKETS];
+	struct schedule		*lru_head;	/* most recently used */
+	struct schedule		*lru_tail;
+	unsigned int		num_entries;
+	unsigned int		max_entries;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
+};
+
+struct schedule_cache *make_schedule_cache(unsigned int max_entries)
+{
+	struct schedule_cache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->max_entries = max_entries ? max_entries : 1;
+	return cache;
+}
+
+static void make_schedule_key(struct plant *new_plant, struct schedule_key *key)
+{
+	memset(key, 0, sizeof(*key));
+	key->num_plants_to_harvest = new_plant->num_plants_to_harvest;
+	key->num_weeks_indoors = new_plant->num_weeks_indoors;
+	key->num_weeks_until_indoor_separation =
+		new_plant->num_weeks_until_indoor_separation;
+	key->outdoor_planting_day =
+		date_to_day_number(&new_plant->outdoor_planting_date);
+	key->num_weeks_until_outdoor_separation =
+		new_plant->num_weeks_until_outdoor_separation;
+	key->days_to_harvest = new_plant->days_to_harvest;
+	key->germination_rate = new_plant->germination_rate;
+	key->min_days_to_sprout = new_plant->min_days_to_sprout;
+	key->avg_days_to_sprout = new_plant->avg_days_to_sprout;
+	key->max_days_to_sprout = new_plant->max_days_to_sprout;
+	key->harvest_removes_plant = new_plant->harvest_removes_plant;
+}
+
+static void free_schedule(struct schedule *schedule)
+{
+	unsigned int i;
+
+	for (i = 0; i < schedule->num_events; i++) {
+		free(schedule->events[i].summary);
+		free(schedule->events[i].description);
+	}
+	free(schedule->events);
+	free(schedule->name);
+	free(schedule);
+}
+
+/* Call with the lock held */
+static void unlink_schedule_lru(struct schedule_cache *cache,
+		struct schedule *schedule)
+{
+	if (schedule->lru_prev)
+		schedule->lru_prev->lru_next = schedule->lru_next;
+	else
+		cache->lru_head = schedule->lru_next;
+	if (schedule->lru_next)
+		schedule->lru_next->lru_prev = schedule->lru_prev;
+	else
+		cache->lru_tail = schedule->lru_prev;
+}
+
+static void link_schedule_lru(struct schedule_cache *cache,
+		struct schedule *schedule)
+{
+	schedule->lru_prev = NULL;
+	schedule->lru_next = cache->lru_head;
+	if (cache->lru_head)
+		cache->lru_head->lru_prev = schedule;
+	else
+		cache->lru_tail = schedule;
+	cache->lru_head = schedule;
+}
+
+/* Drop the least recently used entry.  Call with the lock held. */
+static void evict_schedule(struct schedule_cache *cache)
+{
+	struct schedule *schedule = cache->lru_tail;
+	struct schedule **schedule_ptr;
+
+	unlink_schedule_lru(cache, schedule);
+	for (schedule_ptr = &cache->buckets[schedule->hash %
+			SCHEDULE_CACHE_BUCKETS];
+			*schedule_ptr != schedule;
+			schedule_ptr = &(*schedule_ptr)->next)
+		;
+	*schedule_ptr = schedule->next;
+	cache->num_entries--;
+	cache->evictions++;
+	if (!--schedule->refcount)
+		free_schedule(schedule);
+}
+
+/*
+ * Drop everything the cache holds.  Entries that are still in use are
+ * freed when their last user puts them.
+ */
+void free_schedule_cache(struct schedule_cache *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	while (cache->lru_tail)
+		evict_schedule(cache);
+	pthread_mutex_unlock(&cache->lock);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+void hold_schedule(struct schedule_cache *cache, struct schedule *schedule)
+{
+	pthread_mutex_lock(&cache->lock);
+	schedule->refcount++;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void put_schedule(struct schedule_cache *cache, struct schedule *schedule)
+{
+	int last;
+
+	pthread_mutex_lock(&cache->lock);
+	last = !--schedule->refcount;
+	pthread_mutex_unlock(&cache->lock);
+	if (last)
+		free_schedule(schedule);
+}
+
+/*
+ * Work out a new entry: the plant's dates, and its action item and
+ * harvest calendar entries in date order.
+ */
+static struct schedule *make_schedule(struct plant *new_plant)
+{
+	struct schedule *schedule;
+	struct date_list *head = NULL;
+	struct date_list *item;
+	unsigned int num_events = 0;
+	unsigned int i;
+
+	schedule = calloc(1, sizeof(*schedule));
+	if (!schedule)
+		return NULL;
+	schedule->name = copy_string(new_plant->name);
+	schedule->dates = *new_plant;
+	if (!schedule->name)
+		goto fail;
+	schedule->dates.name = schedule->name;
+	calculate_plant_dates(&schedule->dates);
+
+	if (!add_indoor_plant_dates_to_list(&schedule->dates, &head, 1) ||
+			!add_direct_sown_plant_dates_to_list(&schedule->dates,
+				&head, 1) ||
+			!add_harvest_dates_to_list(&schedule->dates, &head))
+		goto fail;
+	for (item = head; item; item = item->next)
+		num_events++;
+	schedule->events = calloc(num_events + 1, sizeof(*schedule->events));
+	if (!schedule->events)
+		goto fail;
+	schedule->num_events = num_events;
+	for (i = 0, item = head; item; item = item->next, i++) {
+		schedule->events[i].day =
+			date_to_day_number(item->cal_entry->date);
+		schedule->events[i].summary =
+			copy_string(item->cal_entry->summary);
+		schedule->events[i].description =
+			copy_string(item->cal_entry->description);
+		if (!schedule->events[i].summary ||
+				!schedule->events[i].description)
+			goto fail;
+	}
+	free_date_list(head);
+	return schedule;
+
+fail:
+	free_date_list(head);
+	free_schedule(schedule);
+	return NULL;
+}
+
+/*
+ * Find (or make) the schedule for a plant row, and copy its dates into the
+ * plant.  The caller gets a reference, and must put_schedule() it when done
+ * with the entry's calendar entries.
+ */
+struct schedule *get_schedule(struct schedule_cache *cache,
+		struct plant *new_plant)
+{
+	struct schedule_key key;
+	struct schedule *schedule;
+	struct schedule *new_schedule;
+	uint64_t hash;
+
+	make_schedule_key(new_plant, &key);
+	hash = hash_name(new_plant->name, strlen(new_plant->name)) ^
+		(hash_name((char *) &key, sizeof(key)) * 0x9e3779b97f4a7c15ULL);
+
+	pthread_mutex_lock(&cache->lock);
+	for (schedule = cache->buckets[hash % SCHEDULE_CACHE_BUCKETS];
+			schedule; schedule = schedule->next) {
+		if (schedule->hash == hash &&
+				!memcmp(&schedule->key, &key, sizeof(key)) &&
+				!strcmp(schedule->name, new_plant->name))
+			break;
+	}
+	if (schedule) {
+		cache->hits++;
+		schedule->refcount++;
+		unlink_schedule_lru(cache, schedule);
+		link_schedule_lru(cache, schedule);
+		pthread_mutex_unlock(&cache->lock);
+		goto found;
+	}
+	cache->misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	/* Don't hold the lock while doing the real work */
+	new_schedule = make_schedule(new_plant);
+	if (!new_schedule)
+		return NULL;
+	new_schedule->hash = hash;
+	new_schedule->key = key;
+
+	pthread_mutex_lock(&cache->lock);
+	/* Someone else may have added it in the meantime */
+	for (schedule = cache->buckets[hash % SCHEDULE_CACHE_BUCKETS];
+			schedule; schedule = schedule->next) {
+		if (schedule->hash == hash &&
+				!memcmp(&schedule->key, &key, sizeof(key)) &&
+				!strcmp(schedule->name, new_plant->name))
+			break;
+	}
+	if (schedule) {
+		schedule->refcount++;
+		pthread_mutex_unlock(&cache->lock);
+		free_schedule(new_schedule);
+		goto found;
+	}
+	schedule = new_schedule;
+	while (cache->num_entries >= cache->max_entries)
+		evict_schedule(cache);
+	/* One reference for the cache, one for the caller */
+	schedule->refcount = 2;
+	schedule->next = cache->buckets[hash % SCHEDULE_CACHE_BUCKETS];
+	cache->buckets[hash % SCHEDULE_CACHE_BUCKETS] = schedule;
+	link_schedule_lru(cache, schedule);
+	cache->num_entries++;
+	pthread_mutex_unlock(&cache->lock);
+
+found:
+	new_plant->seeding_date = schedule->dates.seeding_date;
+	new_plant->sprouting_date = schedule->dates.sprouting_date;
+	new_plant->last_chance_sprouting_date =
+		schedule->dates.last_chance_sprouting_date;
+	new_plant->indoor_separation_date =
+		schedule->dates.indoor_separation_date;
+	new_plant->hardening_off_date = schedule->dates.hardening_off_date;
+	new_plant->outdoor_separation_date =
+		schedule->dates.outdoor_separation_date;
+	new_plant->harvest_date = schedule->dates.harvest_date;
+	return schedule;
+}
+
+/* How many lookups hit and missed, and how many entries were evicted */
+void get_schedule_cache_stats(struct schedule_cache *cache,
+		unsigned long *hits, unsigned long *misses,
+		unsigned long *evictions)
+{
+	pthread_mutex_lock(&cache->lock);
+	*hits = cache->hits;
+	*misses = cache->misses;
+	*evictions = cache->evictions;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void print_schedule_cache_stats(FILE *out, struct schedule_cache *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	fprintf(out, "schedule cache: %lu hits, %lu misses, %lu evictions, "
+			"%u of %u entries used\n",
+			cache->hits, cache->misses, cache->evictions,
+			cache->num_entries, cache->max_entries);
+	pthread_mutex_unlock(&cache->lock);
+}
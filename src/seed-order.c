@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gardengeek.h"
+
+/****************** Seed order functions ******************/
+
+/*
+ * How many seeds of each variety need to be on hand each week, added up
+ * over a whole batch of gardens.  Each thread takes gardens off the list
+ * and adds them up in its own hash table, so the threads never wait on
+ * each other.  The tables are merged once at the end.
+ *
+ * A garden is read all the way through before any of it is added, so a
+ * garden file that can't be read or has a bad row is left out whole.
+ */
+struct seed_count {
+	/* The variety, and the day number of the week's Monday */
+	struct name_entry	entry;
+	unsigned long		seeds;
+};
+
+struct seed_order_thread {
+	struct seed_order	*order;
+	pthread_t		thread;
+	struct name_table	table;
+	struct plant_list	garden;
+	struct garden_error	error;
+	int			failed;
+};
+
+struct seed_order {
+	char			**filenames;
+	unsigned int		num_files;
+	unsigned int		next_file;
+	struct variety_catalog	*catalog;
+	struct sprout_stats	*stats;
+	FILE			*log;
+	unsigned long		num_skipped;
+};
+
+/* 1970-01-01 was a Thursday, so Mondays are 3 days before a multiple of 7 */
+static int get_week(int day)
+{
+	return day - (((day + 3) % 7) + 7) % 7;
+}
+
+static int add_seeds(struct name_table *table, const char *variety,
+		size_t len, int week, unsigned long seeds)
+{
+	struct seed_count *count;
+
+	count = (struct seed_count *) add_name_entry(table, variety, len,
+			week);
+	if (!count)
+		return 0;
+	count->seeds += seeds;
+	return 1;
+}
+
+static void empty_garden(struct plant_list *garden)
+{
+	while (garden->num_plants)
+		free_plant(garden->plants[--garden->num_plants]);
+}
+
+/*
+ * Add up one garden's seeds, by the catalog's name for each variety, or
+ * else the row's name without any note like "(2nd)".  Returns 0 if the
+ * garden has to be left out, with the reason in the worker's error.
+ */
+static int add_garden_seeds(struct seed_order_thread *worker, FILE *fp)
+{
+	struct seed_order *order = worker->order;
+	struct plant_list *garden = &worker->garden;
+	struct plant *new_plant;
+	struct variety *variety;
+	unsigned long num_skipped = 0;
+	unsigned int i;
+	size_t len;
+	char *name;
+	int ret = 0;
+
+	while ((new_plant = parse_and_create_plant(fp, order->catalog,
+					&worker->error))) {
+		/* Without a region, there's no telling when these go in */
+		if (new_plant->relative_to_last_frost) {
+			num_skipped++;
+			free_plant(new_plant);
+			continue;
+		}
+		if (!add_plant_to_list(garden, new_plant)) {
+			free_plant(new_plant);
+			set_garden_error(&worker->error, GARDEN_NO_MEMORY,
+					NULL);
+			goto out;
+		}
+	}
+	if (worker->error.code != GARDEN_OK)
+		goto out;
+
+	for (i = 0; i < garden->num_plants; i++) {
+		new_plant = garden->plants[i];
+		variety = order->catalog ?
+			find_variety_for_plant(order->catalog,
+					new_plant->name) : NULL;
+		name = variety ? variety->name : new_plant->name;
+		len = variety ? strlen(name) : get_variety_name_length(name);
+		if (order->stats)
+			use_sprout_stats(order->stats, new_plant, NULL);
+		if (!add_seeds(&worker->table, name, len,
+					get_week(get_seeding_day(new_plant)),
+					get_num_seeds_needed(new_plant))) {
+			set_garden_error(&worker->error, GARDEN_NO_MEMORY,
+					NULL);
+			goto out;
+		}
+	}
+	__sync_fetch_and_add(&order->num_skipped, num_skipped);
+	ret = 1;
+out:
+	empty_garden(garden);
+	return ret;
+}
+
+static void log_left_out_garden(struct seed_order *order, char *filename,
+		struct garden_error *error)
+{
+	if (!order->log)
+		return;
+	flockfile(order->log);
+	fprintf(order->log, "Left out %s: ", filename);
+	print_garden_error(order->log, error);
+	funlockfile(order->log);
+}
+
+static void *add_up_gardens(void *data)
+{
+	struct seed_order_thread *worker = data;
+	struct seed_order *order = worker->order;
+	unsigned int i;
+	FILE *fp;
+
+	while (!worker->failed &&
+			(i = __sync_fetch_and_add(&order->next_file, 1)) <
+			order->num_files) {
+		fp = fopen(order->filenames[i], "r");
+		if (!fp) {
+			set_garden_error(&worker->error, GARDEN_BAD_FILE, NULL);
+			log_left_out_garden(order, order->filenames[i],
+					&worker->error);
+			continue;
+		}
+		if (!add_garden_seeds(worker, fp)) {
+			/* Running out of memory stops the whole order */
+			if (worker->error.code == GARDEN_NO_MEMORY)
+				worker->failed = 1;
+			else
+				log_left_out_garden(order,
+						order->filenames[i],
+						&worker->error);
+		}
+		fclose(fp);
+	}
+	return NULL;
+}
+
+static int compare_seed_counts(const void *this, const void *that)
+{
+	const struct seed_count *a = *(struct seed_count * const *) this;
+	const struct seed_count *b = *(struct seed_count * const *) that;
+	int ret = strcmp(a->entry.name, b->entry.name);
+
+	if (ret)
+		return ret;
+	return (a->entry.number > b->entry.number) -
+		(a->entry.number < b->entry.number);
+}
+
+static int compare_weeks(const void *this, const void *that)
+{
+	int a = *(const int *) this;
+	int b = *(const int *) that;
+
+	return (a > b) - (a < b);
+}
+
+/*
+ * One row per variety and one column per week that any seeds go in,
+ * headed by the date of the week's Monday.
+ */
+static int print_seed_table(FILE *out, struct name_table *table)
+{
+	struct seed_count **counts;
+	struct seed_count *count;
+	struct tm date;
+	char string[MAX_NAME_LENGTH];
+	int *weeks;
+	unsigned int num_weeks = 0;
+	unsigned int i, j, next, n = 0;
+
+	counts = malloc(sizeof(*counts)*(table->num_entries + 1));
+	weeks = malloc(sizeof(*weeks)*(table->num_entries + 1));
+	if (!counts || !weeks) {
+		free(counts);
+		free(weeks);
+		return 0;
+	}
+	for (i = 0; i < table->num_slots; i++) {
+		count = (struct seed_count *) get_name_table_slot(table, i);
+		if (!count->entry.name)
+			continue;
+		weeks[n] = count->entry.number;
+		counts[n++] = count;
+	}
+	qsort(counts, n, sizeof(*counts), compare_seed_counts);
+	qsort(weeks, n, sizeof(*weeks), compare_weeks);
+	for (i = 0; i < n; i++)
+		if (!num_weeks || weeks[num_weeks - 1] != weeks[i])
+			weeks[num_weeks++] = weeks[i];
+
+	fprintf(out, "variety");
+	for (j = 0; j < num_weeks; j++) {
+		day_number_to_date(weeks[j], &date);
+		strftime(string, MAX_NAME_LENGTH, "%Y-%m-%d", &date);
+		fprintf(out, ",%s", string);
+	}
+	fprintf(out, "\n");
+
+	for (i = 0; i < n; i = next) {
+		fprintf(out, "%s", counts[i]->entry.name);
+		for (next = i, j = 0; j < num_weeks; j++) {
+			count = next < n ? counts[next] : NULL;
+			if (count && count->entry.number == weeks[j] &&
+					!strcmp(count->entry.name,
+						counts[i]->entry.name)) {
+				fprintf(out, ",%lu", count->seeds);
+				next++;
+			} else {
+				fprintf(out, ",0");
+			}
+		}
+		fprintf(out, "\n");
+	}
+	free(counts);
+	free(weeks);
+	return 1;
+}
+
+/*
+ * Add up the seeds every garden in the list needs, and write them out as a
+ * CSV table of variety by week.  Rows planted relative to the last frost
+ * are left out, since the gardens don't say what region they're in;
+ * num_skipped (if given) says how many there were.  Gardens that can't be
+ * opened or have a bad row are left out, with a line in log (if given)
+ * saying why.  With sprouting statistics, seeds are ordered by the
+ * germination rates gardeners have seen rather than the packet's.
+ */
+int print_seed_order(FILE *out, FILE *log, char **filenames,
+		unsigned int num_files, struct variety_catalog *catalog,
+		struct sprout_stats *stats, unsigned long *num_skipped,
+		struct garden_error *error)
+{
+	struct seed_order order;
+	struct seed_order_thread *workers;
+	struct seed_count *count;
+	unsigned int num_threads;
+	unsigned int i, j;
+	int ret = 1;
+
+	memset(&order, 0, sizeof(order));
+	order.filenames = filenames;
+	order.num_files = num_files;
+	order.catalog = catalog;
+	order.stats = stats;
+	order.log = log;
+
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > num_files)
+		num_threads = num_files ? num_files : 1;
+	workers = calloc(num_threads, sizeof(*workers));
+	if (!workers) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return 0;
+	}
+	for (i = 0; i < num_threads; i++) {
+		workers[i].order = &order;
+		init_name_table(&workers[i].table, sizeof(struct seed_count));
+	}
+
+	/* The first worker is this thread */
+	for (i = 1; i < num_threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, add_up_gardens,
+					&workers[i]))
+			break;
+	add_up_gardens(&workers[0]);
+	num_threads = i;
+	for (i = 1; i < num_threads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	for (i = 0; i < num_threads; i++) {
+		if (workers[i].failed && ret) {
+			if (error)
+				*error = workers[i].error;
+			ret = 0;
+		}
+	}
+
+	/* Merge everything into the first worker's table */
+	for (i = 1; i < num_threads && ret; i++) {
+		for (j = 0; j < workers[i].table.num_slots; j++) {
+			count = (struct seed_count *) get_name_table_slot(
+					&workers[i].table, j);
+			if (!count->entry.name)
+				continue;
+			if (!add_seeds(&workers[0].table, count->entry.name,
+					strlen(count->entry.name),
+					count->entry.number, count->seeds)) {
+				set_garden_error(error, GARDEN_NO_MEMORY,
+						NULL);
+				ret = 0;
+				break;
+			}
+		}
+	}
+
+	if (ret && !print_seed_table(out, &workers[0].table)) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		ret = 0;
+	}
+	if (num_skipped)
+		*num_skipped = order.num_skipped;
+
+	for (i = 0; i < num_threads; i++) {
+		free_name_table(&workers[i].table);
+		free_plant_list(&workers[i].garden);
+	}
+	free(workers);
+	return ret;
+}
@@ -0,0 +1,309 @@
+#define _XOPEN_SOURCE 500 /* glibc2 needs this */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "gardengeek.h"
+
+/****************** Sprouting statistics functions ******************/
+
+/*
+ * The seed packet's germination rate and days to sprout are a guess.  The
+ * observations log says what actually happened each time a variety was
+ * sown: how many seeds went in, how many came up, and when.  Every sowing
+ * is added to a running record for its variety in its region, and to one
+ * for the variety in every region, so each sowing costs a few hash lookups
+ * and adds no matter how many came before it.  Records are kept in a name
+ * table by variety and region number, and regions are numbered as they're
+ * first seen, with 0 for every region.
+ *
+ * Days to sprout are kept as Welford running moments (count, mean, and the
+ * sum of squared differences from the mean), which can be updated one
+ * sowing at a time without keeping the sowings around or losing precision.
+ * The germination rate is seeds that came up over seeds sown.
+ *
+ * Lookups take a read lock, so threads working on different gardens can
+ * all use the same records while new sowings are added.
+ */
+
+/* Don't trust a variety's record until it's been sown this many times */
+#define SPROUT_STATS_MIN_SOWINGS	3
+
+struct sprout_record {
+	/* The variety, and its region's number */
+	struct name_entry	entry;
+	unsigned long		num_sowings;
+	unsigned long		seeds_sown;
+	unsigned long		seeds_sprouted;
+	/* Days to sprout, for the sowings where anything came up */
+	unsigned long		num_sprouted;
+	double			mean_days;
+	double			m2_days;
+	unsigned int		min_days;
+	unsigned int		max_days;
+};
+
+struct sprout_region {
+	struct name_entry	entry;
+	int			number;
+};
+
+struct sprout_stats {
+	pthread_rwlock_t	lock;
+	struct name_table	records;
+	struct name_table	regions;
+	int			num_regions;
+};
+
+struct sprout_stats *make_sprout_stats(void)
+{
+	struct sprout_stats *stats;
+
+	stats = calloc(1, sizeof(*stats));
+	if (!stats)
+		return NULL;
+	pthread_rwlock_init(&stats->lock, NULL);
+	init_name_table(&stats->records, sizeof(struct sprout_record));
+	init_name_table(&stats->regions, sizeof(struct sprout_region));
+	return stats;
+}
+
+void free_sprout_stats(struct sprout_stats *stats)
+{
+	free_name_table(&stats->records);
+	free_name_table(&stats->regions);
+	pthread_rwlock_destroy(&stats->lock);
+	free(stats);
+}
+
+/*
+ * The region's number, or -1 if it's never been seen and add is 0 (or
+ * there's no memory to add it).  Call with the lock held, for writing if
+ * add is 1.
+ */
+static int get_region_number(struct sprout_stats *stats, const char *region,
+		int add)
+{
+	struct sprout_region *entry;
+	size_t len = strlen(region);
+
+	if (!add) {
+		entry = (struct sprout_region *) find_name_entry(
+				&stats->regions, region, len, 0);
+		return entry ? entry->number : -1;
+	}
+	entry = (struct sprout_region *) add_name_entry(&stats->regions,
+			region, len, 0);
+	if (!entry)
+		return -1;
+	if (!entry->number)
+		entry->number = ++stats->num_regions;
+	return entry->number;
+}
+
+static void add_sowing(struct sprout_record *record,
+		unsigned int seeds_sown, unsigned int seeds_sprouted,
+		int days_to_sprout)
+{
+	double delta;
+
+	record->num_sowings++;
+	record->seeds_sown += seeds_sown;
+	record->seeds_sprouted += seeds_sprouted;
+	if (days_to_sprout < 0)
+		return;
+
+	record->num_sprouted++;
+	delta = days_to_sprout - record->mean_days;
+	record->mean_days += delta / record->num_sprouted;
+	record->m2_days += delta * (days_to_sprout - record->mean_days);
+	if (record->num_sprouted == 1 ||
+			(unsigned int) days_to_sprout < record->min_days)
+		record->min_days = days_to_sprout;
+	if ((unsigned int) days_to_sprout > record->max_days)
+		record->max_days = days_to_sprout;
+}
+
+/*
+ * Add one sowing of a variety.  days_to_sprout is -1 if nothing came up.
+ * The region can be NULL if the gardener didn't say where they are.  A
+ * trailing note on the name, like "tomato (2nd)", is left off.
+ */
+int add_sprout_observation(struct sprout_stats *stats, const char *variety,
+		const char *region, unsigned int seeds_sown,
+		unsigned int seeds_sprouted, int days_to_sprout)
+{
+	struct sprout_record *record;
+	size_t len = get_variety_name_length(variety);
+	int number;
+	int ret = 0;
+
+	pthread_rwlock_wrlock(&stats->lock);
+	record = (struct sprout_record *) add_name_entry(&stats->records,
+			variety, len, 0);
+	if (!record)
+		goto out;
+	add_sowing(record, seeds_sown, seeds_sprouted, days_to_sprout);
+	if (region && region[0]) {
+		number = get_region_number(stats, region, 1);
+		if (number < 0)
+			goto out;
+		record = (struct sprout_record *) add_name_entry(
+				&stats->records, variety, len, number);
+		if (!record)
+			goto out;
+		add_sowing(record, seeds_sown, seeds_sprouted, days_to_sprout);
+	}
+	ret = 1;
+out:
+	pthread_rwlock_unlock(&stats->lock);
+	return ret;
+}
+
+static int parse_observation_date(char *string, int *day)
+{
+	struct tm date;
+
+	memset(&date, 0, sizeof(date));
+	if (!strptime(string, "%Y-%m-%d", &date))
+		return 0;
+	*day = date_to_day_number(&date);
+	return 1;
+}
+
+/*
+ * Read an observations log, one sowing per line:
+ *   variety,region,date sown,date sprouted,seeds sown,seeds sprouted
+ * The region can be left empty, and the date sprouted is "-" if nothing
+ * came up.
+ */
+int load_sprout_observations(struct sprout_stats *stats, FILE *fp,
+		struct garden_error *error)
+{
+	char *variety;
+	char region[MAX_NAME_LENGTH];
+	char sown[MAX_NAME_LENGTH];
+	char sprouted[MAX_NAME_LENGTH];
+	unsigned int seeds_sown, seeds_sprouted;
+	int sown_day, sprouted_day;
+	int days_to_sprout;
+
+	while (skip_comment_lines(fp)) {
+		if (!copy_word_from_file(fp, &variety)) {
+			set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+			return 0;
+		}
+		region[0] = sown[0] = sprouted[0] = '\0';
+		seeds_sown = seeds_sprouted = 0;
+		fscanf(fp, "%" MAX_NAME_FIELD "[^,\n]", region);
+		fscanf(fp, "%*[^,\n]");
+		fgetc(fp);
+		fscanf(fp, "%" MAX_NAME_FIELD "[^,\n]", sown);
+		fscanf(fp, "%*[^,\n]");
+		fgetc(fp);
+		fscanf(fp, "%" MAX_NAME_FIELD "[^,\n]", sprouted);
+		fscanf(fp, "%*[^,\n]");
+		fgetc(fp);
+		fscanf(fp, "%u", &seeds_sown);
+		fgetc(fp);
+		fscanf(fp, "%u", &seeds_sprouted);
+		fscanf(fp, "%*[^\n]");
+		fgetc(fp);
+
+		if (seeds_sprouted > seeds_sown) {
+			set_garden_error(error, GARDEN_BAD_SEED_COUNT, variety);
+			free(variety);
+			return 0;
+		}
+		if (!parse_observation_date(sown, &sown_day)) {
+			set_garden_error(error, GARDEN_BAD_DATE, variety);
+			free(variety);
+			return 0;
+		}
+		if (!strcmp(sprouted, "-")) {
+			days_to_sprout = -1;
+		} else if (!parse_observation_date(sprouted, &sprouted_day) ||
+				sprouted_day < sown_day) {
+			set_garden_error(error, GARDEN_BAD_DATE, variety);
+			free(variety);
+			return 0;
+		} else {
+			days_to_sprout = sprouted_day - sown_day;
+		}
+
+		if (!add_sprout_observation(stats, variety, region,
+					seeds_sown, seeds_sprouted,
+					days_to_sprout)) {
+			set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+			free(variety);
+			return 0;
+		}
+		free(variety);
+	}
+	return 1;
+}
+
+/* Call with the lock held */
+static struct sprout_record *find_learned_record(struct sprout_stats *stats,
+		const char *variety, size_t len, int number)
+{
+	struct sprout_record *record;
+
+	record = (struct sprout_record *) find_name_entry(&stats->records,
+			variety, len, number);
+	if (!record || record->num_sowings < SPROUT_STATS_MIN_SOWINGS)
+		return NULL;
+	return record;
+}
+
+/*
+ * Swap the plant's germination rate and days to sprout for what gardeners
+ * have seen, in its region if there are enough sowings there, or else
+ * everywhere.  The last chance to see sprouts is two standard deviations
+ * past the average, when all but a few of the seeds that will come up
+ * have.  Returns 1 if anything about the plant changed.
+ */
+int use_sprout_stats(struct sprout_stats *stats, struct plant *new_plant,
+		const char *region)
+{
+	struct sprout_record *local = NULL;
+	struct sprout_record *everywhere;
+	struct sprout_record *record;
+	size_t len = get_variety_name_length(new_plant->name);
+	double deviation;
+	int number;
+	int ret = 0;
+
+	pthread_rwlock_rdlock(&stats->lock);
+	everywhere = find_learned_record(stats, new_plant->name, len, 0);
+	number = -1;
+	if (region && region[0])
+		number = get_region_number(stats, region, 0);
+	if (number > 0)
+		local = find_learned_record(stats, new_plant->name, len,
+				number);
+
+	/* If nothing ever came up, keep the packet's rate to order from */
+	record = local && local->seeds_sprouted ? local : everywhere;
+	if (record && record->seeds_sprouted) {
+		new_plant->germination_rate = (float) record->seeds_sprouted /
+			record->seeds_sown;
+		ret = 1;
+	}
+
+	record = local && local->num_sprouted >= SPROUT_STATS_MIN_SOWINGS ?
+		local : everywhere;
+	if (record && record->num_sprouted >= SPROUT_STATS_MIN_SOWINGS) {
+		deviation = sqrt(record->m2_days / (record->num_sprouted - 1));
+		new_plant->min_days_to_sprout = record->min_days;
+		new_plant->avg_days_to_sprout = record->mean_days;
+		new_plant->max_days_to_sprout =
+			ceil(record->mean_days + 2*deviation);
+		ret = 1;
+	}
+	pthread_rwlock_unlock(&stats->lock);
+	return ret;
+}
@@ -0,0 +1,752 @@
+#define _XOPEN_SOURCE 700 /* for fmemopen() and open_memstream() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include "gardengeek.h"
+
+/*
+ * Tests for libgardengeek's public API, run by "make test".  Everything is
+ * read from and written to strings in memory, except the seed order, which
+ * needs garden files to open.
+ */
+
+static unsigned int num_checks;
+static unsigned int num_failures;
+
+#define CHECK(cond) do {						\
+	num_checks++;							\
+	if (!(cond)) {							\
+		printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);	\
+		num_failures++;						\
+	}								\
+} while (0)
+
+static FILE *open_string(const char *string)
+{
+	return fmemopen((void *) string, strlen(string), "r");
+}
+
+static int get_day(const char *string)
+{
+	struct tm date;
+
+	memset(&date, 0, sizeof(date));
+	strptime(string, "%Y-%m-%d", &date);
+	return date_to_day_number(&date);
+}
+
+/* Parse the first row of a string, and work out its dates */
+static struct plant *parse_row(const char *row,
+		struct variety_catalog *catalog, struct garden_error *error)
+{
+	struct plant *new_plant;
+	FILE *fp = open_string(row);
+
+	new_plant = parse_and_create_plant(fp, catalog, error);
+	fclose(fp);
+	if (new_plant)
+		calculate_plant_dates(new_plant);
+	return new_plant;
+}
+
+static struct variety_catalog *load_catalog(const char *text,
+		struct garden_error *error)
+{
+	struct variety_catalog *catalog;
+	FILE *fp = open_string(text);
+
+	catalog = load_variety_catalog(fp, error);
+	fclose(fp);
+	return catalog;
+}
+
+static void test_dates(void)
+{
+	struct tm date;
+	int day;
+
+	CHECK(get_day("2000-01-01") == REFERENCE_LAST_FROST);
+	CHECK(get_day("1970-01-01") == 0);
+
+	day_number_to_date(REFERENCE_LAST_FROST + 59, &date);
+	CHECK(date.tm_year == 100 && date.tm_mon == 1 && date.tm_mday == 29);
+	CHECK(date.tm_wday == 2);	/* a Tuesday */
+
+	for (day = -1000; day < 100000; day += 37) {
+		day_number_to_date(day, &date);
+		if (date_to_day_number(&date) != day)
+			break;
+	}
+	CHECK(day >= 100000);
+}
+
+static void test_parse(void)
+{
+	struct garden_error error;
+	struct plant *new_plant;
+	FILE *fp;
+
+	new_plant = parse_row("# a comment\n"
+			"tomato,4,8,3,2010-05-01,0,75,.8,6,14,0,2.5\n",
+			NULL, &error);
+	CHECK(new_plant != NULL);
+	if (new_plant) {
+		CHECK(!strcmp(new_plant->name, "tomato"));
+		CHECK(new_plant->num_plants_to_harvest == 4);
+		CHECK(new_plant->num_weeks_indoors == 8);
+		CHECK(new_plant->square_feet_per_plant == 2.5);
+		CHECK(!new_plant->relative_to_last_frost);
+		CHECK(date_to_day_number(&new_plant->seeding_date) ==
+				get_day("2010-03-06"));
+		CHECK(date_to_day_number(&new_plant->sprouting_date) ==
+				get_day("2010-03-16"));
+		CHECK(date_to_day_number(
+				&new_plant->last_chance_sprouting_date) ==
+				get_day("2010-03-20"));
+		CHECK(date_to_day_number(&new_plant->harvest_date) ==
+				get_day("2010-05-20"));
+		CHECK(get_seeding_day(new_plant) == get_day("2010-03-06"));
+		CHECK(get_num_seeds_needed(new_plant) == 5);
+		free_plant(new_plant);
+	}
+
+	/* Planted relative to the last frost */
+	new_plant = parse_row("beans,20,0,0,+14,0,75,.8,8,16,0\n",
+			NULL, &error);
+	CHECK(new_plant != NULL);
+	if (new_plant) {
+		CHECK(new_plant->relative_to_last_frost);
+		CHECK(new_plant->days_after_last_frost == 14);
+		CHECK(date_to_day_number(&new_plant->outdoor_planting_date) ==
+				REFERENCE_LAST_FROST + 14);
+		free_plant(new_plant);
+	}
+	new_plant = parse_row("peas,20,0,0,-7,0,75,.8,8,16,0\n",
+			NULL, &error);
+	CHECK(new_plant && new_plant->days_after_last_frost == -7);
+	if (new_plant)
+		free_plant(new_plant);
+
+	/* Errors say what went wrong and where */
+	new_plant = parse_row("carrot,3,0,0,2010-13-45,0,80,.5,7,21,1\n",
+			NULL, &error);
+	CHECK(new_plant == NULL);
+	CHECK(error.code == GARDEN_BAD_DATE);
+	CHECK(!strcmp(error.what, "carrot"));
+	CHECK(!strcmp(garden_strerror(error.code), "Bad date"));
+
+	new_plant = parse_row("carrot,3,2010-04-10\n", NULL, &error);
+	CHECK(new_plant == NULL);
+	CHECK(error.code == GARDEN_UNKNOWN_VARIETY);
+
+	/* The end of the file isn't an error */
+	fp = open_string("# nothing but comments\n");
+	CHECK(parse_and_create_plant(fp, NULL, &error) == NULL);
+	CHECK(error.code == GARDEN_OK);
+	fclose(fp);
+}
+
+/* A string of len copies of c, then the rest */
+static char *make_long_string(char c, size_t len, const char *rest)
+{
+	char *string = malloc(len + strlen(rest) + 1);
+
+	if (!string)
+		return NULL;
+	memset(string, c, len);
+	strcpy(string + len, rest);
+	return string;
+}
+
+/*
+ * Parse a row with a long name after a long comment.  Each thread has its
+ * own FILE, so they can all do it at once.
+ */
+static void *parse_long_row(void *data)
+{
+	struct garden_error error;
+	struct plant *new_plant;
+	char *comment, *name, *text;
+	long ret = 0;
+
+	comment = make_long_string('#', 3*MAX_NAME_LENGTH, "\n");
+	name = make_long_string('y', 2*MAX_NAME_LENGTH,
+			",4,8,3,2010-05-01,0,75,.8,6,14,0\n");
+	text = malloc(strlen(comment) + strlen(name) + 1);
+	if (comment && name && text) {
+		strcpy(text, comment);
+		strcat(text, name);
+		new_plant = parse_row(text, NULL, &error);
+		/* Cut short, and the rest of the row still lines up */
+		ret = new_plant &&
+			strlen(new_plant->name) == MAX_NAME_LENGTH - 1 &&
+			new_plant->num_plants_to_harvest == 4 &&
+			new_plant->days_to_harvest == 75;
+		if (new_plant)
+			free_plant(new_plant);
+	}
+	free(comment);
+	free(name);
+	free(text);
+	return (void *) ret;
+}
+
+static void test_long_input(void)
+{
+	struct garden_error error;
+	struct variety_catalog *catalog;
+	pthread_t threads[4];
+	void *ret;
+	char *row;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		CHECK(!pthread_create(&threads[i], NULL, parse_long_row, NULL));
+	for (i = 0; i < 4; i++) {
+		pthread_join(threads[i], &ret);
+		CHECK(ret != NULL);
+	}
+
+	/* A short row's date can be too long to be a date */
+	catalog = load_catalog("tomato,8,3,0,75,.8,6,14,0\n", &error);
+	row = make_long_string('1', 3*MAX_NAME_LENGTH, "\n");
+	CHECK(catalog && row);
+	if (catalog && row) {
+		memcpy(row, "tomato,4,2010-", strlen("tomato,4,2010-"));
+		CHECK(parse_row(row, catalog, &error) == NULL);
+		CHECK(error.code == GARDEN_BAD_DATE);
+	}
+	free(row);
+	if (catalog)
+		free_variety_catalog(catalog);
+}
+
+static void test_catalog(void)
+{
+	struct garden_error error;
+	struct variety_catalog *catalog;
+	struct variety *variety;
+	struct plant *new_plant;
+	char text[64*1024];
+	char name[MAX_NAME_LENGTH];
+	size_t len = 0;
+	int i;
+
+	CHECK(get_variety_name_length("spinach (1st)") == 7);
+	CHECK(get_variety_name_length("spinach") == 7);
+	CHECK(get_variety_name_length("(1st)") == 5);
+
+	catalog = load_catalog("#name,...\n"
+			"tomato,8,3,0,75,.8,6,14,0\n"
+			"basil,6,0,0,60,.7,5,10,0,0.25\n"
+			"spinach,0,0,0,55,.8,6,21,1\n", &error);
+	CHECK(catalog != NULL);
+	if (!catalog)
+		return;
+	variety = find_variety_for_plant(catalog, "tomato (2nd)");
+	CHECK(variety && !strcmp(variety->name, "tomato"));
+	variety = find_variety_for_plant(catalog, "basil");
+	CHECK(variety && variety->square_feet_per_plant == 0.25f);
+	CHECK(find_variety_for_plant(catalog, "tomatillo") == NULL);
+	CHECK(find_variety_for_plant(catalog, "") == NULL);
+
+	/* Short rows fill in the rest from the catalog */
+	new_plant = parse_row("tomato (2nd),4,2010-05-01\n", catalog, &error);
+	CHECK(new_plant != NULL);
+	if (new_plant) {
+		CHECK(!strcmp(new_plant->name, "tomato (2nd)"));
+		CHECK(new_plant->num_weeks_indoors == 8);
+		CHECK(new_plant->days_to_harvest == 75);
+		CHECK(date_to_day_number(&new_plant->harvest_date) ==
+				get_day("2010-05-20"));
+		free_plant(new_plant);
+	}
+	free_variety_catalog(catalog);
+
+	/* Every name in a bigger catalog lands in its own slot */
+	for (i = 0; i < 1000; i++)
+		len += snprintf(text + len, sizeof(text) - len,
+				"variety %d,0,0,0,50,.5,2,15,1\n", i);
+	catalog = load_catalog(text, &error);
+	CHECK(catalog != NULL);
+	if (catalog) {
+		for (i = 0; i < 1000; i++) {
+			snprintf(name, sizeof(name), "variety %d", i);
+			variety = find_variety_for_plant(catalog, name);
+			if (!variety || strcmp(variety->name, name))
+				break;
+		}
+		CHECK(i == 1000);
+		CHECK(find_variety_for_plant(catalog, "variety 1000") == NULL);
+		free_variety_catalog(catalog);
+	}
+
+	catalog = load_catalog("tomato,8,3,0,75,.8,6,14,0\n"
+			"basil,6,0,0,60,.7,5,10,0\n"
+			"tomato,8,3,0,75,.8,6,14,0\n", &error);
+	CHECK(catalog == NULL);
+	CHECK(error.code == GARDEN_DUPLICATE_VARIETY);
+	CHECK(!strcmp(error.what, "tomato"));
+}
+
+static int find_plant(struct plant **plants, unsigned int num_plants,
+		const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_plants; i++)
+		if (!strcmp(plants[i]->name, name))
+			return i;
+	return -1;
+}
+
+static void test_beds(void)
+{
+	struct garden_error error;
+	struct garden_bed *beds;
+	struct plant *plants[5];
+	int plant_beds[5];
+	unsigned int num_beds;
+	unsigned int i;
+	FILE *fp;
+	static const char *rows[] = {
+		/* harvested (and gone) by May 31 */
+		"a,8,0,0,2010-05-01,0,30,1,1,1,1\n",
+		"b,4,0,0,2010-05-01,0,90,1,1,1,0\n",
+		"c,2,0,0,2010-05-02,0,90,1,1,1,0\n",
+		"d,1,0,0,2010-05-03,0,90,1,1,1,0\n",
+		/* goes where a was */
+		"e,8,0,0,2010-06-15,0,30,1,1,1,1\n",
+	};
+
+	fp = open_string("#name,area\nbig,10\nsmall,4\n");
+	beds = load_garden_beds(fp, &num_beds, &error);
+	fclose(fp);
+	CHECK(beds != NULL && num_beds == 2);
+	if (!beds)
+		return;
+
+	for (i = 0; i < 5; i++)
+		plants[i] = parse_row(rows[i], NULL, &error);
+	CHECK(allocate_garden_beds(plants, 5, beds, num_beds, plant_beds));
+	CHECK(plant_beds[find_plant(plants, 5, "a")] == 0);
+	CHECK(plant_beds[find_plant(plants, 5, "b")] == 1);
+	CHECK(plant_beds[find_plant(plants, 5, "c")] == 0);
+	CHECK(plant_beds[find_plant(plants, 5, "d")] == -1);
+	CHECK(plant_beds[find_plant(plants, 5, "e")] == 0);
+	for (i = 0; i < 5; i++)
+		free_plant(plants[i]);
+	free_garden_beds(beds, num_beds);
+
+	fp = open_string("# no beds\n");
+	CHECK(load_garden_beds(fp, &num_beds, &error) == NULL);
+	CHECK(error.code == GARDEN_EMPTY_FILE);
+	fclose(fp);
+}
+
+/* Read the indoor plot, outdoor plot, and each row's area on a day */
+static int get_growth_row(const char *output, const char *date,
+		float *areas, unsigned int num_areas)
+{
+	const char *line = strstr(output, date);
+	unsigned int i;
+	int len;
+
+	if (!line)
+		return 0;
+	line += strlen(date);
+	for (i = 0; i < num_areas; i++) {
+		if (sscanf(line, ",%f%n", &areas[i], &len) != 1)
+			return 0;
+		line += len;
+	}
+	return 1;
+}
+
+static void test_growth(void)
+{
+	struct garden_error error;
+	struct plant *plants[2];
+	float before[4], after[4];
+	char *output;
+	size_t size;
+	FILE *out;
+	unsigned int i;
+	static const char *rows[] = {
+		/* sprouts on April 4 under the lamp, goes out on May 1 */
+		"lamp,1000,4,0,2010-05-01,0,60,1,1,1,1,100\n",
+		/* sprouts outdoors on May 2, and fills 100 x .05 square feet */
+		"cap,100,0,0,2010-05-01,0,30,1,1,1,1,.05\n",
+	};
+	static const char *header = "date,indoor plot,outdoor plot,lamp,cap\n";
+
+	for (i = 0; i < 2; i++)
+		plants[i] = parse_row(rows[i], NULL, &error);
+	out = open_memstream(&output, &size);
+	CHECK(print_growth_simulation(out, plants, 2));
+	fclose(out);
+	CHECK(!strncmp(output, header, strlen(header)));
+
+	/* Doubles every 15 days under the lamp, all in the indoor plot */
+	CHECK(get_growth_row(output, "2010-04-04", before, 4));
+	CHECK(get_growth_row(output, "2010-04-19", after, 4));
+	CHECK(before[2] > 10 && fabs(after[2] - 2*before[2]) < 0.05);
+	CHECK(after[0] == after[2] && after[1] == 0 && after[3] == 0);
+
+	/* and every 10 days outdoors, in the outdoor plot */
+	CHECK(get_growth_row(output, "2010-05-01", before, 4));
+	CHECK(before[0] == 0 && before[1] == before[2]);
+	CHECK(get_growth_row(output, "2010-05-11", after, 4));
+	CHECK(fabs(after[2] - 2*before[2]) < 0.05);
+	CHECK(after[0] == 0 && fabs(after[1] - after[2] - after[3]) < 0.02);
+
+	/* No plant grows past its spacing */
+	CHECK(get_growth_row(output, "2010-05-02", before, 4));
+	CHECK(before[3] > 0 && before[3] < 5);
+	CHECK(get_growth_row(output, "2010-05-26", after, 4));
+	CHECK(after[3] == 5);
+	CHECK(get_growth_row(output, "2010-05-30", after, 4));
+	CHECK(after[3] == 5);
+	free(output);
+
+	for (i = 0; i < 2; i++)
+		free_plant(plants[i]);
+}
+
+static void test_schedule_cache(void)
+{
+	struct garden_error error;
+	struct schedule_cache *cache;
+	struct schedule *schedules[5];
+	struct plant *plants[5];
+	unsigned long hits, misses, evictions;
+	char *stats;
+	size_t size;
+	FILE *out;
+	unsigned int i;
+	static const char *rows[] = {
+		"tomato,4,8,3,2010-05-01,0,75,.8,6,14,0\n",
+		"basil,2,6,0,2010-05-15,0,60,.7,5,10,0\n",
+		"tomato,4,8,3,2010-05-01,0,75,.8,6,14,0\n",
+		"spinach,3,0,0,2010-03-17,0,55,.8,6,21,1\n",
+		"basil,2,6,0,2010-05-15,0,60,.7,5,10,0\n",
+	};
+
+	cache = make_schedule_cache(2);
+	CHECK(cache != NULL);
+	if (!cache)
+		return;
+	for (i = 0; i < 5; i++) {
+		plants[i] = parse_row(rows[i], NULL, &error);
+		memset(&plants[i]->sprouting_date, 0,
+				sizeof(plants[i]->sprouting_date));
+		schedules[i] = get_schedule(cache, plants[i]);
+		CHECK(schedules[i] != NULL);
+	}
+	/* The second tomato row hits; spinach and then basil evict */
+	CHECK(schedules[0] == schedules[2]);
+	CHECK(schedules[1] != schedules[4]);
+	CHECK(schedules[0]->num_events == 5);
+	CHECK(date_to_day_number(&plants[2]->sprouting_date) ==
+			get_day("2010-03-16"));
+
+	get_schedule_cache_stats(cache, &hits, &misses, &evictions);
+	CHECK(hits == 1 && misses == 4 && evictions == 2);
+	out = open_memstream(&stats, &size);
+	print_schedule_cache_stats(out, cache);
+	fclose(out);
+	CHECK(strstr(stats, "2 of 2 entries used") != NULL);
+	free(stats);
+
+	/* Evicted entries stay usable until they're put */
+	for (i = 0; i < 5; i++) {
+		put_schedule(cache, schedules[i]);
+		free_plant(plants[i]);
+	}
+	free_schedule_cache(cache);
+}
+
+static void test_sprout_stats(void)
+{
+	struct garden_error error;
+	struct sprout_stats *stats;
+	struct plant *new_plant;
+	char *row;
+	FILE *fp;
+
+	stats = make_sprout_stats();
+	CHECK(stats != NULL);
+	if (!stats)
+		return;
+	fp = open_string("#variety,region,sown,sprouted,seeds sown,came up\n"
+			"spinach,portland,2010-03-17,2010-03-29,12,7\n"
+			"spinach (2nd),portland,2010-04-06,2010-04-15,12,9\n"
+			"spinach,portland,2011-03-15,2011-03-28,12,8\n"
+			"spinach,corvallis,2011-03-20,2011-03-27,10,9\n"
+			"spinach,,2011-04-01,-,10,0\n"
+			"basil,,2010-04-01,2010-04-08,10,7\n");
+	CHECK(load_sprout_observations(stats, fp, &error));
+	fclose(fp);
+
+	/* Everywhere: days 12, 9, 13, 7, and 33 of 56 seeds came up */
+	new_plant = parse_row("spinach (1st),3,0,0,2010-03-17,0,55,.8,6,21,1\n",
+			NULL, &error);
+	CHECK(use_sprout_stats(stats, new_plant, NULL));
+	CHECK(fabs(new_plant->germination_rate - 33.0/56) < 1e-6);
+	CHECK(fabs(new_plant->avg_days_to_sprout - 10.25) < 1e-6);
+	CHECK(new_plant->min_days_to_sprout == 7);
+	CHECK(new_plant->max_days_to_sprout == 16);
+	calculate_plant_dates(new_plant);
+	CHECK(date_to_day_number(&new_plant->sprouting_date) ==
+			get_day("2010-03-27"));
+
+	/* Portland has enough sowings of its own: days 12, 9, 13 */
+	CHECK(use_sprout_stats(stats, new_plant, "portland"));
+	CHECK(fabs(new_plant->germination_rate - 24.0/36) < 1e-6);
+	CHECK(fabs(new_plant->avg_days_to_sprout - 34.0/3) < 1e-5);
+	CHECK(new_plant->min_days_to_sprout == 9);
+	CHECK(new_plant->max_days_to_sprout == 16);
+
+	/* Corvallis doesn't, so it gets the numbers from everywhere */
+	CHECK(use_sprout_stats(stats, new_plant, "corvallis"));
+	CHECK(fabs(new_plant->avg_days_to_sprout - 10.25) < 1e-6);
+	free_plant(new_plant);
+
+	/* One sowing isn't enough to go on */
+	new_plant = parse_row("basil,2,6,0,2010-05-15,0,60,.7,5,10,0\n",
+			NULL, &error);
+	CHECK(!use_sprout_stats(stats, new_plant, NULL));
+	CHECK(fabs(new_plant->germination_rate - .7) < 1e-6);
+
+	/* An overlong region is cut short, and the sowing still counts */
+	row = make_long_string('r', 3*MAX_NAME_LENGTH,
+			",2010-04-01,2010-04-08,10,8\n");
+	CHECK(row != NULL);
+	if (row) {
+		memcpy(row, "basil,", strlen("basil,"));
+		fp = open_string(row);
+		CHECK(load_sprout_observations(stats, fp, &error));
+		fclose(fp);
+		free(row);
+	}
+	fp = open_string("basil,,2010-04-02,2010-04-09,10,8\n");
+	CHECK(load_sprout_observations(stats, fp, &error));
+	fclose(fp);
+	CHECK(use_sprout_stats(stats, new_plant, NULL));
+	free_plant(new_plant);
+
+	fp = open_string("basil,,2010-04-01,2010-04-08,10,11\n");
+	CHECK(!load_sprout_observations(stats, fp, &error));
+	CHECK(error.code == GARDEN_BAD_SEED_COUNT);
+	fclose(fp);
+	fp = open_string("basil,,2010-04-08,2010-04-01,10,1\n");
+	CHECK(!load_sprout_observations(stats, fp, &error));
+	CHECK(error.code == GARDEN_BAD_DATE);
+	fclose(fp);
+	free_sprout_stats(stats);
+}
+
+static char *write_temp_garden(const char *rows)
+{
+	char *filename = copy_string("/tmp/gardengeek-test-XXXXXX");
+	int fd = mkstemp(filename);
+
+	write(fd, rows, strlen(rows));
+	close(fd);
+	return filename;
+}
+
+static void test_seed_order(void)
+{
+	struct garden_error error;
+	char *filenames[3];
+	char *table, *log;
+	size_t table_size, log_size;
+	unsigned long num_skipped;
+	FILE *out, *log_fp;
+
+	filenames[0] = write_temp_garden(
+			"spinach (1st),4,0,0,2010-03-17,0,60,.8,6,21,1\n"
+			"spinach (2nd),4,0,0,2010-03-19,0,60,.8,6,21,1\n"
+			"beans,20,0,0,+14,0,75,.8,8,16,0\n"
+			"tomato,4,8,3,2010-05-01,0,75,.8,6,14,0\n");
+	filenames[1] = write_temp_garden(
+			"spinach,4,0,0,2010-03-17,0,60,.8,6,21,1\n"
+			"carrot,3,0,0,2010-13-45,0,80,.5,7,21,1\n");
+	filenames[2] = copy_string("/nonexistent/garden.csv");
+
+	out = open_memstream(&table, &table_size);
+	log_fp = open_memstream(&log, &log_size);
+	CHECK(print_seed_order(out, log_fp, filenames, 3, NULL, NULL,
+				&num_skipped, &error));
+	fclose(out);
+	fclose(log_fp);
+
+	/* Both spinach rows go in the week of Monday, March 15 */
+	CHECK(!strcmp(table, "variety,2010-03-01,2010-03-15\n"
+				"spinach,0,10\n"
+				"tomato,5,0\n"));
+	CHECK(num_skipped == 1);
+	CHECK(strstr(log, "Bad date: carrot") != NULL);
+	CHECK(strstr(log, "Left out /nonexistent/garden.csv") != NULL);
+
+	free(table);
+	free(log);
+	unlink(filenames[0]);
+	unlink(filenames[1]);
+	free(filenames[0]);
+	free(filenames[1]);
+	free(filenames[2]);
+}
+
+struct counting_sink {
+	struct reminder_sink	sink;
+	unsigned int		num_sent[2];
+	unsigned int		first_day;
+};
+
+static int count_reminder(struct reminder_sink *sink,
+		struct reminder *reminder)
+{
+	struct counting_sink *counter = (struct counting_sink *) sink;
+	int garden = !strcmp(reminder->garden->name, "h");
+
+	if (!counter->num_sent[0] && !counter->num_sent[1])
+		counter->first_day = reminder->day;
+	counter->num_sent[garden]++;
+	return 1;
+}
+
+static int flush_nothing(struct reminder_sink *sink)
+{
+	return 1;
+}
+
+static void test_reminders(void)
+{
+	struct garden_error error;
+	struct counting_sink counter;
+	struct reminder_sink *sinks[1] = { &counter.sink };
+	struct reminder_wheel *wheel;
+	static const char *garden = "tomato,4,8,3,2010-05-01,0,75,.8,6,14,0\n";
+	FILE *fp;
+	int i;
+
+	memset(&counter, 0, sizeof(counter));
+	counter.sink.send = count_reminder;
+	counter.sink.flush = flush_nothing;
+	wheel = make_reminder_wheel(sinks, 1, get_day("2010-01-01"));
+	CHECK(wheel != NULL);
+	if (!wheel)
+		return;
+
+	/* Adding a garden again replaces it; removing one drops it */
+	for (i = 0; i < 2; i++) {
+		fp = open_string(garden);
+		CHECK(add_garden(wheel, "g", fp, NULL, NULL, &error));
+		fclose(fp);
+	}
+	fp = open_string(garden);
+	CHECK(add_garden(wheel, "h", fp, NULL, NULL, &error));
+	fclose(fp);
+	remove_garden(wheel, "h");
+
+	run_reminders_until(wheel, get_day("2010-03-05"));
+	CHECK(counter.num_sent[0] == 0);
+	run_reminders_until(wheel, get_day("2010-03-06"));
+	CHECK(counter.num_sent[0] == 1);
+	CHECK(counter.first_day == (unsigned int) get_day("2010-03-06"));
+
+	/* A garden added after the day has run still gets today's reminders */
+	fp = open_string(garden);
+	CHECK(add_garden(wheel, "h", fp, NULL, NULL, &error));
+	fclose(fp);
+	CHECK(counter.num_sent[1] == 1);
+	remove_garden(wheel, "h");
+
+	run_reminders_until(wheel, get_day("2010-12-31"));
+	/* seed, separate, harden off, transplant, harvest */
+	CHECK(counter.num_sent[0] == 5);
+	CHECK(counter.num_sent[1] == 1);
+
+	fp = open_string("carrot,3,0,0,2010-13-45,0,80,.5,7,21,1\n");
+	CHECK(!add_garden(wheel, "c", fp, NULL, NULL, &error));
+	CHECK(error.code == GARDEN_BAD_DATE);
+	fclose(fp);
+	free_reminder_wheel(wheel);
+}
+
+static void test_regions(void)
+{
+	struct garden_error error;
+	struct plant_list garden = { NULL, 0, 0 };
+	struct region *regions;
+	unsigned int num_regions;
+	char *calendars;
+	size_t size;
+	FILE *fp, *out;
+
+	fp = open_string("#region,last frost\n"
+			"97201 portland,2010-04-01\n"
+			"97002 aurora,2010-04-15\n");
+	regions = load_regions(fp, &num_regions, &error);
+	fclose(fp);
+	CHECK(regions != NULL && num_regions == 2);
+	if (!regions)
+		return;
+
+	add_plant_to_list(&garden, parse_row(
+				"beans,20,0,0,+14,0,75,.8,8,16,0\n",
+				NULL, &error));
+	add_plant_to_list(&garden, parse_row(
+				"peas,6,0,0,2010-03-01,0,60,.8,6,14,0\n",
+				NULL, &error));
+	out = open_memstream(&calendars, &size);
+	CHECK(make_region_calendars(out, &garden, regions, num_regions,
+				BY_PLANT, 0, NULL));
+	fclose(out);
+	CHECK(strstr(calendars, "97201 portland (last frost Thu, Apr. 01, "
+				"2010)") != NULL);
+	CHECK(strstr(calendars, "Direct sow 25 seeds outdoors: Thu, Apr. 15, "
+				"2010") != NULL);
+	CHECK(strstr(calendars, "Direct sow 25 seeds outdoors: Thu, Apr. 29, "
+				"2010") != NULL);
+	/* Rows with their own date are the same everywhere */
+	CHECK(strstr(strstr(calendars, "aurora"),
+				"Direct sow 8 seeds outdoors: Mon, Mar. 01, "
+				"2010") != NULL);
+	free(calendars);
+	free_plant_list(&garden);
+	free_regions(regions, num_regions);
+
+	fp = open_string("portland,2010-13-01\n");
+	CHECK(load_regions(fp, &num_regions, &error) == NULL);
+	CHECK(error.code == GARDEN_BAD_DATE);
+	fclose(fp);
+}
+
+int main(void)
+{
+	test_dates();
+	test_parse();
+	test_long_input();
+	test_catalog();
+	test_beds();
+	test_growth();
+	test_schedule_cache();
+	test_sprout_stats();
+	test_seed_order();
+	test_reminders();
+	test_regions();
+
+	if (num_failures) {
+		printf("%u of %u checks failed\n", num_failures, num_checks);
+		return 1;
+	}
+	printf("All %u checks passed\n", num_checks);
+	return 0;
+}
@@ -0,0 +1,593 @@
+#ifdef HAVE_CAIRO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <cairo.h>
+#include <cairo-pdf.h>
+#include "gardengeek.h"
+
+/****************** Wall calendar functions ******************/
+
+/* US letter, landscape, in points */
+#define PAGE_WIDTH		792.0
+#define PAGE_HEIGHT		612.0
+#define PAGE_MARGIN		36.0
+#define PNG_DPI			150.0
+
+#define TITLE_FONT_SIZE		28.0
+#define HEADER_FONT_SIZE	10.0
+#define DAY_FONT_SIZE		10.0
+#define ITEM_FONT_SIZE		7.0
+
+/* The grid gets the top of the page, the list of important dates the rest */
+#define GRID_FRACTION		0.68
+
+#define TEXT_CACHE_SLOTS	4096
+
+/*
+ * The same action items ("Harvest: basil") show up on page after page,
+ * and calendar after calendar.  Remember how wide each one is, so the
+ * pages only ask cairo to lay out text they haven't seen before.
+ */
+struct text_width {
+	uint64_t	hash;
+	char		*text;
+	double		width;
+};
+
+struct text_width_cache {
+	pthread_rwlock_t	lock;
+	cairo_scaled_font_t	*font;
+	struct text_width	slots[TEXT_CACHE_SLOTS];
+	unsigned int		num_used;
+};
+
+/*
+ * Fonts are set up once and shared by all the pages, so their glyph caches
+ * are too.  Cairo's scaled fonts are safe to use from several threads.
+ */
+struct wall_calendar_fonts {
+	cairo_scaled_font_t	*title;
+	cairo_scaled_font_t	*header;
+	cairo_scaled_font_t	*day;
+	cairo_scaled_font_t	*item;
+	struct text_width_cache	item_widths;
+};
+
+/* One month, and the part of the (sorted) action list that falls in it */
+struct calendar_page {
+	int			year;
+	int			month;
+	struct date_list	*first;
+	unsigned int		num_entries;
+	cairo_surface_t		*surface;
+	char			*png_filename;
+};
+
+struct wall_calendar {
+	struct calendar_page		*pages;
+	unsigned int			num_pages;
+	unsigned int			next_page;
+	struct wall_calendar_fonts	*fonts;
+	int				use_pdf;
+	int				failed;
+};
+
+static cairo_scaled_font_t *make_scaled_font(const char *family,
+		cairo_font_weight_t weight, double size)
+{
+	cairo_font_face_t *face;
+	cairo_scaled_font_t *font;
+	cairo_font_options_t *options;
+	cairo_matrix_t font_matrix;
+	cairo_matrix_t ctm;
+
+	face = cairo_toy_font_face_create(family, CAIRO_FONT_SLANT_NORMAL,
+			weight);
+	options = cairo_font_options_create();
+	/* Don't hint, so the widths are the same at any resolution */
+	cairo_font_options_set_hint_metrics(options, CAIRO_HINT_METRICS_OFF);
+	cairo_matrix_init_scale(&font_matrix, size, size);
+	cairo_matrix_init_identity(&ctm);
+	font = cairo_scaled_font_create(face, &font_matrix, &ctm, options);
+	cairo_font_options_destroy(options);
+	cairo_font_face_destroy(face);
+	if (cairo_scaled_font_status(font) != CAIRO_STATUS_SUCCESS) {
+		cairo_scaled_font_destroy(font);
+		return NULL;
+	}
+	return font;
+}
+
+struct wall_calendar_fonts *make_wall_calendar_fonts(
+		struct garden_error *error)
+{
+	struct wall_calendar_fonts *fonts;
+
+	fonts = malloc(sizeof(*fonts));
+	if (!fonts) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return NULL;
+	}
+	memset(fonts, 0, sizeof(*fonts));
+	pthread_rwlock_init(&fonts->item_widths.lock, NULL);
+
+	fonts->title = make_scaled_font("serif", CAIRO_FONT_WEIGHT_BOLD,
+			TITLE_FONT_SIZE);
+	fonts->header = make_scaled_font("sans-serif", CAIRO_FONT_WEIGHT_BOLD,
+			HEADER_FONT_SIZE);
+	fonts->day = make_scaled_font("sans-serif", CAIRO_FONT_WEIGHT_BOLD,
+			DAY_FONT_SIZE);
+	fonts->item = make_scaled_font("sans-serif", CAIRO_FONT_WEIGHT_NORMAL,
+			ITEM_FONT_SIZE);
+	if (!fonts->title || !fonts->header || !fonts->day || !fonts->item) {
+		free_wall_calendar_fonts(fonts);
+		set_garden_error(error, GARDEN_NO_FONTS, NULL);
+		return NULL;
+	}
+	fonts->item_widths.font = fonts->item;
+	return fonts;
+}
+
+void free_wall_calendar_fonts(struct wall_calendar_fonts *fonts)
+{
+	unsigned int i;
+
+	/* Destroying a NULL font does nothing */
+	cairo_scaled_font_destroy(fonts->title);
+	cairo_scaled_font_destroy(fonts->header);
+	cairo_scaled_font_destroy(fonts->day);
+	cairo_scaled_font_destroy(fonts->item);
+	for (i = 0; i < TEXT_CACHE_SLOTS; i++)
+		free(fonts->item_widths.slots[i].text);
+	pthread_rwlock_destroy(&fonts->item_widths.lock);
+	free(fonts);
+}
+
+static double get_text_width(struct text_width_cache *cache, const char *text)
+{
+	cairo_text_extents_t extents;
+	struct text_width *slot;
+	uint64_t hash;
+	unsigned int i, start;
+	size_t len = strlen(text);
+
+	hash = hash_name(text, len);
+	start = hash % TEXT_CACHE_SLOTS;
+
+	pthread_rwlock_rdlock(&cache->lock);
+	for (i = start; ; i = (i + 1) % TEXT_CACHE_SLOTS) {
+		slot = &cache->slots[i];
+		if (!slot->text)
+			break;
+		if (slot->hash == hash && !strcmp(slot->text, text)) {
+			pthread_rwlock_unlock(&cache->lock);
+			return slot->width;
+		}
+		if ((i + 1) % TEXT_CACHE_SLOTS == start)
+			break;
+	}
+	pthread_rwlock_unlock(&cache->lock);
+
+	cairo_scaled_font_text_extents(cache->font, text, &extents);
+
+	/* Keep the table at most 3/4 full so the probes stay short */
+	pthread_rwlock_wrlock(&cache->lock);
+	if (cache->num_used < TEXT_CACHE_SLOTS/4*3) {
+		for (i = start; cache->slots[i].text;
+				i = (i + 1) % TEXT_CACHE_SLOTS) {
+			if (cache->slots[i].hash == hash &&
+					!strcmp(cache->slots[i].text, text))
+				break;
+		}
+		slot = &cache->slots[i];
+		if (!slot->text) {
+			slot->text = malloc(len + 1);
+			if (slot->text) {
+				strcpy(slot->text, text);
+				slot->hash = hash;
+				slot->width = extents.x_advance;
+				cache->num_used++;
+			}
+		}
+	}
+	pthread_rwlock_unlock(&cache->lock);
+	return extents.x_advance;
+}
+
+/*
+ * Draw text at the current point, cut short with "..." if it's wider
+ * than max_width.
+ */
+static void show_fitted_text(cairo_t *cr, struct text_width_cache *cache,
+		const char *text, double max_width)
+{
+	cairo_text_extents_t extents;
+	char string[MAX_NAME_LENGTH];
+	size_t len;
+
+	if (get_text_width(cache, text) <= max_width) {
+		cairo_show_text(cr, text);
+		return;
+	}
+	snprintf(string, MAX_NAME_LENGTH, "%s", text);
+	/* Leave room for the "..." after the last character kept */
+	len = strlen(string);
+	if (len > MAX_NAME_LENGTH - sizeof("..."))
+		len = MAX_NAME_LENGTH - sizeof("...");
+	for (; len > 0; len--) {
+		strcpy(&string[len - 1], "...");
+		cairo_text_extents(cr, string, &extents);
+		if (extents.x_advance <= max_width)
+			break;
+		string[len - 1] = '\0';
+	}
+	cairo_show_text(cr, string);
+}
+
+/* How many days in the page's month, and what day of the week it starts */
+static void get_month_shape(struct calendar_page *page, int *first_wday,
+		int *num_days)
+{
+	struct tm first;
+	struct tm next;
+	int first_day;
+
+	memset(&first, 0, sizeof(first));
+	first.tm_year = page->year;
+	first.tm_mon = page->month;
+	first.tm_mday = 1;
+	next = first;
+	next.tm_mon++;
+	if (next.tm_mon == 12) {
+		next.tm_mon = 0;
+		next.tm_year++;
+	}
+	first_day = date_to_day_number(&first);
+	day_number_to_date(first_day, &first);
+	*first_wday = first.tm_wday;
+	*num_days = date_to_day_number(&next) - first_day;
+}
+
+static void draw_calendar_grid(cairo_t *cr, struct calendar_page *page,
+		struct wall_calendar_fonts *fonts, double top, double bottom)
+{
+	struct tm weekday;
+	struct date_list *item, *next;
+	char string[MAX_NAME_LENGTH];
+	double cell_width = (PAGE_WIDTH - 2*PAGE_MARGIN) / 7;
+	double cell_height;
+	double x, y, line;
+	int first_wday, num_days, num_rows;
+	int day, cell, max_lines;
+	unsigned int i, num_today, remaining;
+
+	get_month_shape(page, &first_wday, &num_days);
+	num_rows = (first_wday + num_days + 6) / 7;
+
+	/* Weekday names across the top, starting with Sunday */
+	cairo_set_scaled_font(cr, fonts->header);
+	for (i = 0; i < 7; i++) {
+		day_number_to_date(3 + i, &weekday);
+		strftime(string, MAX_NAME_LENGTH, "%A", &weekday);
+		cairo_move_to(cr, PAGE_MARGIN + i*cell_width + 4,
+				top + HEADER_FONT_SIZE);
+		cairo_show_text(cr, string);
+	}
+	top += HEADER_FONT_SIZE + 4;
+	cell_height = (bottom - top) / num_rows;
+
+	cairo_set_line_width(cr, 0.75);
+	for (cell = 0; cell < num_rows * 7; cell++) {
+		x = PAGE_MARGIN + (cell % 7) * cell_width;
+		y = top + (cell / 7) * cell_height;
+		cairo_rectangle(cr, x, y, cell_width, cell_height);
+	}
+	cairo_stroke(cr);
+
+	max_lines = (cell_height - DAY_FONT_SIZE - 6) / (ITEM_FONT_SIZE + 2);
+	if (max_lines < 1)
+		max_lines = 1;
+	item = page->first;
+	remaining = page->num_entries;
+	for (day = 1; day <= num_days; day++) {
+		cell = first_wday + day - 1;
+		x = PAGE_MARGIN + (cell % 7) * cell_width;
+		y = top + (cell / 7) * cell_height;
+
+		cairo_set_scaled_font(cr, fonts->day);
+		snprintf(string, MAX_NAME_LENGTH, "%i", day);
+		cairo_move_to(cr, x + 4, y + DAY_FONT_SIZE + 2);
+		cairo_show_text(cr, string);
+
+		for (num_today = 0, next = item; num_today < remaining &&
+				next->cal_entry->date->tm_mday == day;
+				num_today++)
+			next = next->next;
+
+		/* If they don't all fit, the last line says how many didn't */
+		cairo_set_scaled_font(cr, fonts->item);
+		line = y + DAY_FONT_SIZE + 4;
+		for (i = 0; i < num_today; i++, item = item->next) {
+			if (i >= (unsigned int) max_lines)
+				continue;
+			line += ITEM_FONT_SIZE + 2;
+			cairo_move_to(cr, x + 4, line);
+			if (i == (unsigned int) max_lines - 1 &&
+					num_today > (unsigned int) max_lines) {
+				snprintf(string, MAX_NAME_LENGTH,
+						"+%u more", num_today - i);
+				cairo_show_text(cr, string);
+				continue;
+			}
+			show_fitted_text(cr, &fonts->item_widths,
+					item->cal_entry->summary,
+					cell_width - 8);
+		}
+		remaining -= num_today;
+	}
+}
+
+/*
+ * The "Important dates this month" list from docs/goals.txt, flowing down
+ * three columns under the grid.
+ */
+static void draw_important_dates(cairo_t *cr, struct calendar_page *page,
+		struct wall_calendar_fonts *fonts, double top, double bottom)
+{
+	struct date_list *item;
+	char string[MAX_NAME_LENGTH];
+	char date[MAX_NAME_LENGTH];
+	double column_width = (PAGE_WIDTH - 2*PAGE_MARGIN) / 3;
+	double line_height = ITEM_FONT_SIZE + 2;
+	int lines_per_column;
+	unsigned int i;
+
+	cairo_set_scaled_font(cr, fonts->header);
+	cairo_move_to(cr, PAGE_MARGIN, top + HEADER_FONT_SIZE);
+	cairo_show_text(cr, "Important dates this month:");
+	top += HEADER_FONT_SIZE + 4;
+
+	lines_per_column = (bottom - top) / line_height;
+	if (lines_per_column < 1)
+		return;
+
+	cairo_set_scaled_font(cr, fonts->item);
+	for (i = 0, item = page->first; i < page->num_entries &&
+			i < 3 * (unsigned int) lines_per_column;
+			i++, item = item->next) {
+		strftime(date, MAX_NAME_LENGTH, "%m/%d", item->cal_entry->date);
+		snprintf(string, MAX_NAME_LENGTH, "%s - %s", date,
+				item->cal_entry->description);
+		cairo_move_to(cr, PAGE_MARGIN + (i / lines_per_column) *
+				column_width,
+				top + (i % lines_per_column + 1) * line_height);
+		show_fitted_text(cr, &fonts->item_widths, string,
+				column_width - 8);
+	}
+}
+
+static void draw_calendar_page(cairo_t *cr, struct calendar_page *page,
+		struct wall_calendar_fonts *fonts)
+{
+	struct tm month;
+	char string[MAX_NAME_LENGTH];
+	double grid_top, grid_bottom;
+
+	cairo_set_source_rgb(cr, 1, 1, 1);
+	cairo_paint(cr);
+	cairo_set_source_rgb(cr, 0, 0, 0);
+
+	memset(&month, 0, sizeof(month));
+	month.tm_year = page->year;
+	month.tm_mon = page->month;
+	month.tm_mday = 1;
+	strftime(string, MAX_NAME_LENGTH, "%B %Y", &month);
+	cairo_set_scaled_font(cr, fonts->title);
+	cairo_move_to(cr, PAGE_MARGIN, PAGE_MARGIN + TITLE_FONT_SIZE);
+	cairo_show_text(cr, string);
+
+	grid_top = PAGE_MARGIN + TITLE_FONT_SIZE + 12;
+	grid_bottom = grid_top + (PAGE_HEIGHT - PAGE_MARGIN - grid_top) *
+		GRID_FRACTION;
+	draw_calendar_grid(cr, page, fonts, grid_top, grid_bottom);
+	draw_important_dates(cr, page, fonts, grid_bottom + 12,
+			PAGE_HEIGHT - PAGE_MARGIN);
+}
+
+/*
+ * Every page gets its own surface, so pages can be drawn at the same
+ * time.  PNG pages are written out as soon as they're done.  PDF pages are
+ * recorded, and played back into the one PDF file in order afterwards.
+ */
+static int render_calendar_page(struct calendar_page *page,
+		struct wall_calendar_fonts *fonts, int use_pdf)
+{
+	cairo_rectangle_t extents = { 0, 0, PAGE_WIDTH, PAGE_HEIGHT };
+	cairo_t *cr;
+	int ret = 1;
+
+	if (use_pdf)
+		page->surface = cairo_recording_surface_create(
+				CAIRO_CONTENT_COLOR_ALPHA, &extents);
+	else
+		page->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+				PAGE_WIDTH * PNG_DPI / 72,
+				PAGE_HEIGHT * PNG_DPI / 72);
+	cr = cairo_create(page->surface);
+	if (!use_pdf)
+		cairo_scale(cr, PNG_DPI / 72, PNG_DPI / 72);
+	draw_calendar_page(cr, page, fonts);
+	if (cairo_status(cr) != CAIRO_STATUS_SUCCESS)
+		ret = 0;
+	cairo_destroy(cr);
+
+	if (!use_pdf) {
+		if (cairo_surface_write_to_png(page->surface,
+					page->png_filename) !=
+				CAIRO_STATUS_SUCCESS)
+			ret = 0;
+		cairo_surface_destroy(page->surface);
+		page->surface = NULL;
+	}
+	return ret;
+}
+
+static void *render_calendar_pages(void *data)
+{
+	struct wall_calendar *calendar = data;
+	unsigned int i;
+
+	while ((i = __sync_fetch_and_add(&calendar->next_page, 1)) <
+			calendar->num_pages) {
+		if (!render_calendar_page(&calendar->pages[i],
+					calendar->fonts, calendar->use_pdf))
+			__sync_fetch_and_or(&calendar->failed, 1);
+	}
+	return NULL;
+}
+
+/* Split the sorted action list up into one page per month */
+static int make_calendar_pages(struct wall_calendar *calendar,
+		struct date_list *head, char *filename)
+{
+	struct date_list *item;
+	struct calendar_page *page = NULL;
+	struct tm *date;
+	struct tm *prev = NULL;
+	unsigned int num_pages = 0;
+	char string[MAX_NAME_LENGTH];
+	char *dot;
+	unsigned int i;
+	size_t len;
+
+	for (item = head; item; item = item->next) {
+		date = item->cal_entry->date;
+		if (item == head || prev->tm_mon != date->tm_mon ||
+				prev->tm_year != date->tm_year)
+			num_pages++;
+		prev = date;
+	}
+
+	calendar->pages = calloc(num_pages + 1, sizeof(*calendar->pages));
+	if (!calendar->pages)
+		return 0;
+
+	page = NULL;
+	for (item = head; item; item = item->next) {
+		date = item->cal_entry->date;
+		if (!page || page->month != date->tm_mon ||
+				page->year != date->tm_year) {
+			page = &calendar->pages[calendar->num_pages++];
+			page->year = date->tm_year;
+			page->month = date->tm_mon;
+			page->first = item;
+		}
+		page->num_entries++;
+	}
+
+	if (calendar->use_pdf)
+		return 1;
+
+	/* garden.png or garden becomes garden-2010-03.png, and so on */
+	dot = strrchr(filename, '.');
+	len = dot ? (size_t) (dot - filename) : strlen(filename);
+	for (i = 0; i < calendar->num_pages; i++) {
+		page = &calendar->pages[i];
+		snprintf(string, MAX_NAME_LENGTH, "%.*s-%04i-%02i.png",
+				(int) len, filename,
+				page->year + 1900, page->month + 1);
+		page->png_filename = malloc(strlen(string) + 1);
+		if (!page->png_filename)
+			return 0;
+		strcpy(page->png_filename, string);
+	}
+	return 1;
+}
+
+/*
+ * Print a wall calendar: one page per month with the action items in the
+ * day squares.  A filename ending in .pdf makes one PDF with a page per
+ * month; anything else makes a PNG per month.
+ */
+int make_wall_calendar(struct date_list *head, char *filename,
+		struct wall_calendar_fonts *fonts, struct garden_error *error)
+{
+	struct wall_calendar calendar;
+	pthread_t *threads;
+	cairo_surface_t *pdf;
+	cairo_t *cr;
+	size_t len = strlen(filename);
+	unsigned int num_threads;
+	unsigned int i;
+	int ret = 1;
+
+	if (!head)
+		return 1;
+
+	memset(&calendar, 0, sizeof(calendar));
+	calendar.fonts = fonts;
+	calendar.use_pdf = len > 4 && !strcmp(&filename[len - 4], ".pdf");
+	if (!make_calendar_pages(&calendar, head, filename)) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return 0;
+	}
+
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > calendar.num_pages)
+		num_threads = calendar.num_pages;
+	/* This thread draws pages too, so start one less */
+	num_threads--;
+	threads = malloc(sizeof(*threads)*num_threads);
+	if (num_threads && !threads) {
+		set_garden_error(error, GARDEN_NO_MEMORY, NULL);
+		return 0;
+	}
+	for (i = 0; i < num_threads; i++)
+		if (pthread_create(&threads[i], NULL, render_calendar_pages,
+					&calendar))
+			break;
+	/* If we couldn't start a thread, this one still does the work */
+	render_calendar_pages(&calendar);
+	num_threads = i;
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	if (calendar.failed)
+		ret = 0;
+
+	if (calendar.use_pdf) {
+		pdf = cairo_pdf_surface_create(filename, PAGE_WIDTH,
+				PAGE_HEIGHT);
+		cr = cairo_create(pdf);
+		for (i = 0; i < calendar.num_pages; i++) {
+			cairo_set_source_surface(cr,
+					calendar.pages[i].surface, 0, 0);
+			cairo_paint(cr);
+			cairo_show_page(cr);
+			cairo_surface_destroy(calendar.pages[i].surface);
+		}
+		if (cairo_status(cr) != CAIRO_STATUS_SUCCESS)
+			ret = 0;
+		cairo_destroy(cr);
+		cairo_surface_finish(pdf);
+		if (cairo_surface_status(pdf) != CAIRO_STATUS_SUCCESS)
+			ret = 0;
+		cairo_surface_destroy(pdf);
+	}
+
+	for (i = 0; i < calendar.num_pages; i++)
+		free(calendar.pages[i].png_filename);
+	free(calendar.pages);
+	if (!ret)
+		set_garden_error(error, GARDEN_NO_DRAWING, filename);
+	return ret;
+}
+
+#endif /* HAVE_CAIRO */